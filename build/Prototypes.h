@@ -0,0 +1,53 @@
+void SaveResetCause(void);
+boolean BootAnimation(void);
+boolean PrintBanner(void);
+void loop();
+void Calibrate(void);
+boolean CalibrationTimedOut(void);
+void CalibrateMin (void);
+void CalibrateMax (void);
+void CalibrationReset(void);
+void CalibrationSample(void);
+boolean CalibrationFinished(void);
+boolean CalibrationAccepted(void);
+void CalibrationFailed(void);
+void CalibrationPrint(void);
+void CalibrationWaitForRelease(void);
+void TraceStart(void);
+void TraceStop(void);
+void TraceSample(unsigned int Sample1, unsigned int Sample2);
+void TraceFlush(void);
+void BandgapStart(void);
+void BandgapUpdate(void);
+boolean BandgapHolding(void);
+void BandgapApply(unsigned int Bandgap);
+void BandgapRead(void);
+void RSSIAverageFill(void);
+void TrackerSetup(void);
+void TrackerUpdate(void);
+void HealthCheck(int Rx, unsigned int Sample);
+unsigned int HealthProbe(int Pin);
+boolean HealthLED(int Rx, boolean Selected);
+void DecisionRecord(int PreviousRxState, unsigned long Elapsed);
+void DecisionDump(void);
+void InjectStart(void);
+void InjectReceive(void);
+void InjectNextSample(void);
+void InjectSwitch(void);
+void RSSIPairRead(void);
+unsigned int RSSIConvert(int Next);
+unsigned int LatestReading(unsigned int *Readings, unsigned int ReadIndex);
+void DisplayBargraph(unsigned int RSSIAverage, unsigned int RSSIMin, unsigned int RSSIMax);
+byte BargraphBrightness(int Level);
+void UpdateRSSINoise(void);
+void UpdateDiversityPolicy(void);
+int DiversityDecide(int Selected, unsigned long Elapsed);
+int DiversityCompare(int Selected, unsigned long Elapsed);
+int PolicyLevel(int Selected, unsigned long Elapsed);
+int PolicyScored(int Selected, unsigned long Elapsed);
+int PolicyFreeze(int Selected, unsigned long Elapsed);
+void StatsReset(void);
+void StatsUpdate(void);
+void StatsAccumulate(int Rx, unsigned int Sample, int Percent, unsigned long Elapsed);
+void StatsPrint(void);
+void LoopTiming(void);
@@ -0,0 +1,3751 @@
+/*****************************************************************************
+ Dual 5.8ghz Video Receiver Diversity Controller with RX5808-PRO functionality.
+ "Div4RX5808-PRO"
+ Mike Dalton 2015
+
+ RC VIDEO RECEIVER SOFTWARE FOR ATMEGA328.
+
+ RX5808-PRO SUPPORT!
+ LIVE VIDEO / SPECTRUM ANALYSER SWITCHING VIA PUSH BUTTON!
+ SINGLE RX OR DIVERSITY MODES VIA PUSH BUTTON!
+ SERIAL DEBUG MODE VIA PUSH BUTTON!
+ MODE LED INDICATORS!
+ SOFTWARE SWITCH DE-BOUNCING!
+ VARIABLE SOFTWARE RSSI SMOOTHING!
+ RSSI VALUES VIA 4 LEDS! (PWM DIMMED BARGRAPH)
+ VARIABLE RX SWITCHING RATE!
+ AUTO RSSI CALIBRATION!
+ LINK STATISTICS VIA SERIAL!
+ BINARY RSSI TRACE CAPTURE VIA SERIAL!
+ DEAD RECEIVER DETECTION AND FAILOVER!
+ ADC REFERENCE DRIFT COMPENSATION!
+ RSSI TRACE INJECTION VIA SERIAL FOR BENCH TESTING!
+ RACE / STANDARD / BENCH BUILD PROFILES!
+ ANTENNA TRACKER SERVO OUTPUT FROM PATCH / OMNI RSSI! (OPTIONAL)
+ DIVERSITY DECISION TRACE VIA SERIAL!
+ SELECTABLE DIVERSITY POLICIES, FROZEN WHILST THE SPECTRUM ANALYSER IS SHOWN!
+
+
+ Physical pins used:
+
+ A0      RSSI1_ADC_PIN           ANALOGUE INPUT    left channel RSSI input (RX1, 0.5V-1.2V).
+ A1      RSSI2_ADC_PIN           ANALOGUE INPUT    right channel RSSI input (RX2, 0.5V-1.2V).
+ A2      (LED_075_P)             (OUTPUT)          (AMBER LED to display RSSI between 51%-75% when TRACKER_ENABLED, no dimming).
+ A3      N/A                     N/A               N/A
+ A4      N/A                     N/A               N/A
+ A5      N/A                     N/A               N/A
+ A6      N/A                     N/A               N/A
+ A7      N/A                     N/A               N/A
+ D0      SERIAL                  TX                Serial connection (DEBUG AT 19200, TRACE INJECTION AT 115200 IN PROFILE_BENCH)
+ D1      SERIAL                  RX                Serial connection
+ D2      MODE_SWITCH             INPUT PULLUP      Switch 1, Mode select between left channel, right channel and diversity using RSSI. (ENTERS DEBUG MODE AT POWER UP)
+ D3      VIDEO_SWITCH            INPUT PULLUP      Switch 2, selects between live video output from selected receiver and ATV (spectrum analyser) output from RX8505-PRO board.
+ D4      RX_CONTROL_PIN          OUTPUT            Pin to control switching between receiver 1 and 2, default LOW - RX1.
+ D5      VIDEO_CONTROL_PIN       OUTPUT            Pin to control switching between live video and ATV. (ATV = Arduino TV out - SPECTRUM ANALYSER)
+ D6      LED_RX_1                OUTPUT            LED for RX1 radio. (BLINKS 1/2/3 TIMES FOR STUCK/RAIL/FLOATING RSSI)
+ D7      LED_RX_2                OUTPUT            LED for RX2 radio. (BLINKS 1/2/3 TIMES FOR STUCK/RAIL/FLOATING RSSI)
+ D8      LED_025_P               OUTPUT            RED LED to display RSSI between 0%-25%.
+ D9      LED_050_P               OUTPUT (PWM)      AMBER LED to display RSSI between 26$-50%.
+ D10     LED_075_P               OUTPUT (PWM)      AMBER LED to display RSSI between 51%-75%.
+         (TRACKER_SERVO_PIN)     (OUTPUT, TIMER1)  (Antenna tracker pan servo when TRACKER_ENABLED, LED moves to A2, D9 LED loses dimming).
+ D11     LED_100_P               OUTPUT (PWM)      GREEN LED to display RSSI between 76%-100%
+ D12     LED_DIVERSITY           OUTPUT            GREEN LED to display if Diversity is Enabled.
+ D13     LED_HEARTBEAT           OUTPUT            HEART BEAT LED
+ AREF    (OPTION)                (INPUT)           (OPTIONAL VOLTAGE REFERENCE TO INCREASE RESOLUTION FOR RX THAT USE RSSI >1.1V).
+
+
+ The main settings to change the behaviour of the unit:
+
+ BUILD_PROFILE                   PROFILE_RACE, PROFILE_STANDARD or PROFILE_BENCH. (see below)
+
+ BUTTON_DEBOUNCE_MILLIS          Alters repeat speed of push buttons.
+ MAX_AVERAGE_READINGS            Smoothing value for taking average RSSI readings.
+ RSSI_HYSTERESIS                 Minimum overhead for RSSI signal (RX switching) in diversity mode.
+ RSSI_HYSTERESIS_MAX             Maximum overhead for RSSI signal when receivers are noisy.
+ RSSI_NOISE_GAIN                 How many RSSI noise standard deviations make up the hysteresis.
+ DIVERSITY_INTERVAL_MIN_MILLIS   Shortest time, in milliseconds, between receiver toggles on a clean signal.
+ DIVERSITY_INTERVAL_MILLIS       Longest time, in milliseconds, between receiver toggles on a noisy signal.
+ DIVERSITY_POLICY                How receivers are compared in diversity mode, POLICY_LEVEL, POLICY_SCORED or POLICY_FREEZE.
+ SPECTRUM_POLICY                 How receivers are compared whilst the spectrum analyser is shown, default POLICY_FREEZE.
+
+ RSSI1Min, RSSI1Max              The default expected ADC readings for your RX.
+ RSSI2Min, RSSI2Max              The default expected ADC readings for your RX.
+
+ CALIB_TIMEOUT_MILLIS            Time between starting Auto Calibration and giving up.
+ ONE_TIME_WARMUP_DELAY           The amount of time you expect your TX gear (RC model) to take to settle in after power up.
+ CALIB_CONFIDENCE                How tightly (ADC steps) each calibrated RSSI limit must be known before finishing early.
+ CALIB_MAX_DISAGREEMENT          Largest difference (ADC steps) allowed between the two receivers during calibration.
+
+ RSSI_ADC_REFERENCE              ADC voltage reference, INTERNAL (1V1), DEFAULT (supply) or EXTERNAL (AREF pin).
+ BANDGAP_INTERVAL_MILLIS         Time between checks of the ADC reference against the supply.
+
+ STATS_OUTAGE_LEVEL              RSSI % below which a receiver is counted as being in outage.
+ DECISION_SLOW_MILLIS            Receiver switches slower than this hold the decision trace until it is dumped.
+
+ TRACKER_ENABLED                 Drive a ground station antenna tracker pan servo on D10.
+ TRACKER_PATCH_RX                Which receiver has the patch antenna, the other must have the omni.
+
+
+ Build profiles:
+
+ PROFILE_RACE                    Diversity, LEDs and receiver health only. No serial port, no auto calibration,
+                                 no link statistics. Set RSSI1Min/Max and RSSI2Min/Max by hand.
+ PROFILE_STANDARD                Serial debug, auto calibration, link statistics and trace, chosen with the
+                                 buttons at power up.
+ PROFILE_BENCH                   As PROFILE_STANDARD, plus every debug figure, loop timing and trace injection.
+
+ Features left out of a profile are tested against constants, so the compiler
+ drops both the code and its checks from the loop. tools/profiles.sh builds all
+ three with arduino-cli and reports the flash and RAM of each.
+ *******************************************************************************/
+
+
+
+/* Build profile. */
+#define PROFILE_RACE 1                                  /* Smallest and quickest build, for flying. */
+#define PROFILE_STANDARD 2                              /* Everything chosen at power up with the buttons. */
+#define PROFILE_BENCH 3                                 /* Full instrumentation, for bench testing. */
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE PROFILE_STANDARD                  /* Can be given on the compiler command line. (see tools/profiles.sh) Default PROFILE_STANDARD. */
+#endif
+#ifndef TRACKER_ENABLED
+#define TRACKER_ENABLED false                           /* Antenna tracker servo on D10, bargraph LED moves to A2. (see Antenna tracker below) Default false. */
+#endif
+
+#if BUILD_PROFILE == PROFILE_RACE
+#define FEATURE_SERIAL false                            /* Serial debug, link statistics and trace. */
+#define FEATURE_CALIBRATION false                       /* Auto RSSI calibration. */
+#define FEATURE_INSTRUMENTATION false                   /* Every debug figure and loop timing. */
+#define FEATURE_INJECTION false                         /* Trace injection, listened for at power up. */
+#define BUILD_PROFILE_NAME "RACE"
+#elif BUILD_PROFILE == PROFILE_BENCH
+#define FEATURE_SERIAL true
+#define FEATURE_CALIBRATION true
+#define FEATURE_INSTRUMENTATION true
+#define FEATURE_INJECTION true
+#define BUILD_PROFILE_NAME "BENCH"
+#else
+#define FEATURE_SERIAL true
+#define FEATURE_CALIBRATION true
+#define FEATURE_INSTRUMENTATION false
+#define FEATURE_INJECTION false
+#define BUILD_PROFILE_NAME "STANDARD"
+#endif
+
+/* Physical pin assignments. */
+#define RSSI1_ADC_PIN A0                                /* ADC connected to reciever 1 RSSI output pin. */
+#define RSSI2_ADC_PIN A1                                /* ADC connected to reciever 2 RSSI output pin. */
+#define MODE_SWITCH 2                                   /* Press this button to switch between available RX modes. */
+#define VIDEO_SWITCH 3                                  /* Press this button to switch between live video and spectrum analyser. */
+#define RX_CONTROL_PIN 4                                /* Toggled by software to select RX unit. */
+#define VIDEO_CONTROL_PIN 5                             /* Toggled by software to select between live video and spectrum analyser. */
+
+/* LEDs. */
+#define LED_RX_1 6                                      /* RX1 status LED. */
+#define LED_RX_2 7                                      /* RX2 status LED. */
+#define LED_025_P 8                                     /* RSSI 0%-25% status LED. */
+#define LED_050_P 9                                     /* RSSI 26%-50% status LED. */
+#if TRACKER_ENABLED == true
+#define LED_075_P A2                                    /* RSSI 51%-75% status LED. D10 drives the tracker servo. */
+#else
+#define LED_075_P 10                                    /* RSSI 51%-75% status LED. */
+#endif
+#define LED_100_P 11                                    /* RSSI 76%-100% status LED. */
+#define LED_DIVERSITY 12                                /* Diversity active indicator LED. */
+#define LED_HEARTBEAT 13                                /* Heartbeat, indicates loop speed, for initial debug. */
+
+/* Delays. */
+#define ADC_WARMUP_READS 4                              /* Conversions thrown away on each RSSI pin to let the ADC settle at power up. Default 4. */
+#define BOOT_ANIMATION_STEP_MILLIS 150                  /* Time between steps of the power up LED animation. Default 150. */
+#define BOOT_ANIMATION_STEPS 6                          /* Steps in the power up LED animation. */
+#define BUTTON_DEBOUNCE_MILLIS 250                      /* Push button debounce value. Default 250. */
+#define DIVERSITY_INTERVAL_MILLIS 2000                  /* Minimum allowable time before video pin toggles on a noisy signal. Default 2000. */
+#define DIVERSITY_INTERVAL_MIN_MILLIS 100               /* Minimum allowable time before video pin toggles on a clean signal. Default 100. */
+#define DIVERSITY_NOISE_MILLIS 150                      /* Extra toggle time added per 1% of RSSI noise. Default 150. */
+#define CALIB_MAX_MILLIS 750                            /* Longest time spent sampling for each calibration stage. Default 750. */
+#define CALIB_TIMEOUT_MILLIS 30000                      /* Give up calibrating after X seconds. Default 30000. */
+#define ONE_TIME_WARMUP_DELAY 5000                      /* A one time delay to allow voltages to stabilize on the TX and RC model during Auto Calibration. Default 5000. */
+#define CALIB_RETRY_INITIAL_DELAY 10000                 /* Wait period before starting calibration after first attempt fails. Default 5000. */
+
+/* Info. */
+#define AUTHOR "MIKE DALTON"                            /* Version info. */
+#define INFO_MAJOR_VERSION "1"                          /* Version info. */
+#define INFO_MINOR_VERSION "9"                          /* Version info. */
+#define COMPILE_TIME __TIME__                           /* Version info. */
+#define COMPILE_DATE __DATE__                           /* Version info. */
+#define SOURCE_FILE __FILE__                            /* Version info. */
+#define COMPILER __VERSION__                            /* Version info. */
+
+/* RSSI. */
+#define MAX_AVERAGE_READINGS 10                         /* Smoothing value for RSSI averages. Default 10. */
+#define RSSI_HYSTERESIS 1                               /* This hysteresis value is a % of the calculated RSSI value. Minimum used on a clean signal. Default 1. */
+#define RSSI_HYSTERESIS_MAX 15                          /* Largest hysteresis applied on a noisy signal, %. Default 15. */
+#define RSSI_NOISE_GAIN 4                               /* Hysteresis = RSSI_NOISE_GAIN x RSSI noise (standard deviation). Default 4. */
+#define RSSI_NOISE_SHIFT 4                              /* Noise estimate smoothing, 2^shift passes. Default 4. */
+#define RSSI_NOISE_FRACTION 8                           /* Fraction bits kept in the smoothed squared change, so changes of 1% register. Default 8. */
+#define RSSI_ADC_PRESCALER (_BV(ADPS2) | _BV(ADPS1))    /* ADC clock for paired RSSI sampling, 16MHz / 64 = 250kHz, over the datasheet's 200kHz for 10 bits. 52us per reading. (Arduino default /128, ~112us) */
+#define RSSI_ADC_CLOCK_MICROS 4                         /* One ADC clock at RSSI_ADC_PRESCALER, after which the next channel can be selected. */
+
+/* Diversity policy. */
+#define POLICY_LEVEL 0                                  /* Highest averaged RSSI % wins. */
+#define POLICY_SCORED 1                                 /* Averaged RSSI %, less a penalty for noise, plus a bonus for rising RSSI. */
+#define POLICY_FREEZE 2                                 /* Stay on the selected receiver. A faulty receiver is still dropped. */
+#define POLICY_COUNT 3                                  /* Number of policies, each has a decision function. (see DiversityDecide) */
+#define DIVERSITY_POLICY POLICY_LEVEL                   /* Policy in live video. Default POLICY_LEVEL. */
+#define SPECTRUM_POLICY POLICY_FREEZE                   /* Policy whilst the spectrum analyser is shown, switching would corrupt the display. Default POLICY_FREEZE. */
+#define POLICY_UPDATE_MILLIS 50                         /* Time between updates of the noise and trend terms. Default 50. */
+#define POLICY_NOISE_WEIGHT 1.0                         /* Score lost per % of ADC reading spread (standard deviation). Default 1.0. */
+#define POLICY_TREND_WEIGHT 0.25                        /* Score gained per % the RSSI rose over the last POLICY_UPDATE_MILLIS. Default 0.25. */
+#define POLICY_BONUS_MAX 20                             /* Largest score, in %, the noise and trend terms can add or take away. Default 20. */
+#define POLICY_BONUS_SMOOTH 8                           /* Noise and trend terms are smoothed over this many updates, 400ms. Default 8. */
+#define POLICY_SERIAL_CYCLE 'p'                         /* Send this character in debug mode to step through the live video policies. */
+
+/* RSSI bargraph. */
+#define BARGRAPH_FULL_SCALE 1024                        /* Bargraph resolution, 256 steps for each of the four LEDs. */
+#define BARGRAPH_SEGMENT 256                            /* Bargraph steps per LED. */
+#define BARGRAPH_HYSTERESIS 6                           /* Bargraph steps the RSSI must move before the display follows. Default 6. */
+
+/* Calibration. */
+#define CALIB_MIN_SAMPLES 32                            /* Fewest samples of each RSSI before a calibration stage may finish. Default 32. */
+#define CALIB_CONFIDENCE 0.5                            /* Finish once the 95% confidence interval on each mean is within +/- this many ADC steps. Default 0.5. */
+#define CALIB_OUTLIER_SIGMA 4                           /* Reject calibration samples further than this many standard deviations from the mean. Default 4. */
+#define CALIB_MIN_QUALITY 50                            /* Lowest calibration quality score (0-100) that is accepted. Default 50. */
+#define CALIB_MAX_DISAGREEMENT 200                      /* Fail calibration if the receivers differ by more than this many ADC steps. Default 200. */
+
+/* Link statistics. */
+#define STATS_HISTOGRAM_BINS 16                         /* RSSI histogram bins, each bin covers 64 ADC counts. Default 16. */
+#define STATS_HISTOGRAM_SHIFT 6                         /* ADC reading >> shift = histogram bin. (1024 / 16 = 64 = 2^6) */
+#define STATS_OUTAGE_LEVEL 10                           /* RSSI % below which a receiver is in outage. Default 10. */
+#define STATS_SERIAL_QUERY 's'                          /* Send this character in debug mode to print link statistics. */
+#define STATS_SERIAL_RESET 'r'                          /* Send this character in debug mode to reset link statistics. */
+
+/* ADC reference. */
+#define RSSI_ADC_REFERENCE INTERNAL                     /* INTERNAL = 1V1 bandgap, DEFAULT = supply voltage, EXTERNAL = reference IC on AREF. Default INTERNAL. */
+#define BANDGAP_NOMINAL_VOLTS 1.1                       /* Data sheet bandgap voltage, parts vary from 1.0V to 1.2V. */
+#define SUPPLY_NOMINAL_VOLTS 5.0                        /* Regulated supply (AVcc) voltage. Default 5.0. */
+#define BANDGAP_INTERVAL_MILLIS 30000                   /* Time between checks of the ADC reference. Default 30000. */
+#define BANDGAP_READINGS 64                             /* Bandgap readings summed for each check. Default 64. */
+#define BANDGAP_PASS_READINGS 8                         /* Bandgap readings taken in each loop pass of a check. Default 8. */
+#define BANDGAP_SETTLE_MILLIS 20                        /* Time for the AREF capacitor to settle back on the 1V1 reference. Default 20. */
+#define BANDGAP_IDLE 0                                  /* No check in progress. */
+#define BANDGAP_READING 1                               /* ADC on the bandgap against AVcc, a few readings each pass. */
+#define BANDGAP_SETTLING 2                              /* ADC back on RSSI, waiting for AREF to settle before the result is used. */
+
+/* Antenna tracker. Steers a patch antenna using its RSSI against an omni on the other receiver. */
+#define TRACKER_SERVO_PIN 10                            /* Servo signal. Must be D10, the pulse is made by Timer1 output OC1B. */
+#define TRACKER_PATCH_RX 1                              /* Receiver on the patch antenna, 0 = RX1, 1 = RX2. The other has the omni. Default 1. */
+#define TRACKER_INTERVAL_MILLIS 20                      /* Control update period, one per servo frame. Default 20. */
+#define TRACKER_SERVO_MIN 1000                          /* Shortest servo pulse, microseconds. Default 1000. */
+#define TRACKER_SERVO_MAX 2000                          /* Longest servo pulse, microseconds. Default 2000. */
+#define TRACKER_SERVO_CENTRE 1500                       /* Servo pulse at power up, microseconds. Default 1500. */
+#define TRACKER_DITHER 30                               /* Servo is rocked this many microseconds either side of its aim to find the slope. Default 30. */
+#define TRACKER_DITHER_UPDATES 6                        /* Updates spent on each side of the rock. Default 6. */
+#define TRACKER_SETTLE_UPDATES 3                        /* Updates ignored after each rock whilst the servo and RSSI averages settle. Default 3. */
+#define TRACKER_KP 1.0                                  /* Proportional gain, microseconds per 0.1% of RSSI slope. Default 1.0. */
+#define TRACKER_KI 2.5                                  /* Integral gain, microseconds per 0.1% of RSSI slope per rock. Default 2.5. */
+#define TRACKER_SLEW 20                                 /* Fastest servo movement, microseconds per update. Default 20. */
+#define TRACKER_LOSS_LEVEL -100                         /* Patch this far below the omni, in 0.1% of RSSI, counts as off target. Default -100. */
+#define TRACKER_LOSS_MILLIS 1000                        /* Time off target before scanning. Default 1000. */
+#define TRACKER_ACQUIRE_LEVEL 0                         /* Patch this far above the omni, in 0.1% of RSSI, ends a scan. Default 0. */
+#define TRACKER_SCAN_STEP 10                            /* Servo movement per update whilst scanning, microseconds. Default 10. */
+
+/* Receiver health. */
+#define HEALTH_OK 0                                     /* Receiver RSSI looks plausible. */
+#define HEALTH_STUCK 1                                  /* RSSI reading hasn't changed at all for HEALTH_STUCK_SAMPLES. */
+#define HEALTH_RAIL 2                                   /* RSSI reading is pinned near 0V, receiver dead or unpowered. */
+#define HEALTH_FLOATING 3                               /* RSSI reading follows whatever the ADC converted before it, wire off and input floating. */
+#define HEALTH_STUCK_SAMPLES 500                        /* Identical readings in a row before RSSI is called stuck. Default 500. */
+#define HEALTH_RAIL_LOW 50                              /* ADC reading below which RSSI is pinned to 0V. (RX5808 RSSI never goes below ~0.5V) Default 50. */
+#define HEALTH_FULL_SCALE 1020                          /* ADC reading from which RSSI is over the reference, steady readings there aren't stuck. Default 1020. */
+#define HEALTH_PROBE_LIMIT 100                          /* Drop in ADC reading, after converting 0V, at which RSSI is floating. Default 100. */
+#define HEALTH_PROBE_MILLIS 100                         /* Time between floating input probes of each receiver. Default 100. */
+#define HEALTH_PROBE_FAILS 3                            /* Failed probes in a row before RSSI is called floating. Default 3. */
+#define HEALTH_RECOVERY_MILLIS 1000                     /* Time a faulty receiver must look healthy before it can be used again. Default 1000. */
+#define HEALTH_BLINK_MILLIS 200                         /* Length of each blink of a faulty receiver's LED. Default 200. */
+#define HEALTH_BLINK_PERIOD_MILLIS 2000                 /* Time between groups of blinks of a faulty receiver's LED. Default 2000. */
+
+/* RSSI trace. */
+#define TRACE_SERIAL_TOGGLE 't'                         /* Send this character in debug mode to start / stop binary RSSI trace output. */
+#define TRACE_INTERVAL_MILLIS 5                         /* Time between trace samples. Default 5. */
+#define TRACE_BLOCK_SAMPLES 28                          /* Samples per trace block, a full block fits the serial transmit buffer. Default 28. */
+#define TRACE_HEADER_BYTES 18                           /* Size of the trace header. */
+#define TRACE_BLOCK_HEADER_BYTES 8                      /* Bytes at the start of a trace block, before the deltas. */
+#define TRACE_VERSION 1                                 /* Trace format version. */
+#define TRACE_SYNC 0xA5                                 /* First byte of every trace block. */
+
+/* Trace injection. */
+#define INJECT_BAUD 115200                              /* Serial speed for trace injection. Default 115200. */
+#define INJECT_LISTEN_MILLIS 50                         /* Time after setup() finishes that a host can ask for trace injection. Default 50. */
+#define INJECT_TIMEOUT_MILLIS 500                       /* Time the loop waits for the host before going back to the receivers. Default 500. */
+#define INJECT_ACK 0x06                                 /* Sent back when an injected block has been used up. */
+#define INJECT_NAK 0x15                                 /* Sent back when an injected block fails its checksum. */
+#define INJECT_SWITCH 0x5A                              /* Sent back when the diversity logic changes receiver. */
+
+/* Diversity decision trace. */
+#define DECISION_SERIAL_DUMP 'd'                        /* Send this character in debug mode to dump the decision trace. */
+#define DECISION_SERIAL_QUIET 'q'                       /* Send this character in debug mode to stop / start the debug text, so decisions are timed at full loop speed. */
+#define DECISION_RECORDS 32                             /* Records kept in the decision trace ring. Default 32. */
+#define DECISION_RECORD_BYTES 12                        /* Size of each decision record. */
+#define DECISION_HEADER_BYTES 8                         /* Size of the decision trace dump header. */
+#define DECISION_VERSION 2                              /* Decision trace format version. */
+#define DECISION_SLOW_MILLIS 500                        /* A switch this long after the raw RSSI crossed over holds the trace. Default 500. */
+#define DECISION_HOLD_BETTER 0                          /* Selected receiver's average is as good as or better than the other. */
+#define DECISION_HOLD_HYSTERESIS 1                      /* Other receiver's average is better, but not by more than the hysteresis. */
+#define DECISION_HOLD_DWELL 2                           /* Other receiver is better by more than the hysteresis, toggle time not up. */
+#define DECISION_SWITCH 3                               /* Switched to the other receiver on RSSI. */
+#define DECISION_QUARANTINE 4                           /* Held on, or switched to, the only healthy receiver. */
+#define DECISION_HOLD_FROZEN 5                          /* Policy is POLICY_FREEZE. */
+
+/* Linker. */
+extern char __data_load_end;                            /* End of code and initialised data in flash. (avr-libc linker script) */
+
+                                                        /* RSSI voltage range is between 0.5v and 1.1v for most rx5808 modules. */
+unsigned int RSSI1Min = 512;                            /* Default 512. */
+unsigned int RSSI1Max = 1023;                           /* 1024 = 1.1V when using internal voltage reference. Default 1024. */
+unsigned int RSSI2Min = 512;                            /* Default 512. */
+unsigned int RSSI2Max = 1023;                           /* 1024 = 1.1V when using internal voltage reference. Default 1024. */
+int RSSI1P = 0;                                         /* Mapped RSSI value as a percentage - taken from min and max values. */
+int RSSI2P = 0;                                         /* Mapped RSSI value as a percentage - taken from min and max values. */
+unsigned int RSSI1Readings[MAX_AVERAGE_READINGS];       /* The readings from the analogue input. */
+unsigned int RSSI1ReadIndex = 0;                        /* The index of the current reading. */
+unsigned int RSSI1Total = 0;                            /* The running total. */
+unsigned int RSSI1Average = 0;                          /* The average RSSI. */
+unsigned int RSSI1InputPinValue = 0;                    /* ADC reading. */
+unsigned int RSSI2Readings[MAX_AVERAGE_READINGS];       /* The readings from the analogue input. */
+unsigned int RSSI2ReadIndex = 0;                        /* The index of the current reading. */
+unsigned int RSSI2Total = 0;                            /* The running total. */
+unsigned int RSSI2Average = 0;                          /* The average RSSI. */
+unsigned int RSSI2InputPinValue = 0;                    /* ADC reading. */
+boolean RSSIAverageFilled = false;                      /* False until the averages hold readings against a settled reference. */
+
+/* Receiver health. Index 0 = RX1, index 1 = RX2. */
+byte HealthFault[2];                                    /* HEALTH_OK or the fault seen on the receiver. */
+unsigned int HealthPrevious[2];                         /* Previous ADC reading. */
+unsigned int HealthStuckCount[2];                       /* Identical ADC readings in a row. */
+byte HealthProbeFails[2];                               /* Failed floating input probes in a row. */
+unsigned long HealthProbeTime[2];                       /* Time of the last floating input probe. */
+unsigned long HealthFaultTime[2];                       /* Time a fault was last seen. */
+
+/* Trace. */
+boolean TraceMode = false;                              /* True whilst binary RSSI trace is being sent instead of debug text. */
+boolean QuietMode = false;                              /* True whilst the per pass debug text is stopped. */
+unsigned long TracePreviousTime = 0;                    /* Time of the previous trace sample. */
+unsigned int TraceSequence = 0;                         /* Sequence number of the trace block being built. */
+byte TraceBlockSamples = 0;                             /* Samples in the trace block being built. */
+unsigned int TracePrevious1 = 0;                        /* Previous RX1 trace sample, deltas are taken from this. */
+unsigned int TracePrevious2 = 0;                        /* Previous RX2 trace sample, deltas are taken from this. */
+byte TraceBlock[TRACE_BLOCK_HEADER_BYTES + (2 * (TRACE_BLOCK_SAMPLES - 1)) + 1];   /* Trace block being built, with room for the checksum. */
+
+/* Diversity decision trace. */
+byte DecisionRing[DECISION_RECORDS][DECISION_RECORD_BYTES];     /* Decision records, oldest overwritten first. */
+byte DecisionHead = 0;                                  /* Next record to be written. */
+byte DecisionCount = 0;                                 /* Records held in the ring. */
+byte DecisionPreviousKey = 0xFF;                        /* Rule, receiver and raw RSSI order of the last record. */
+boolean DecisionHeld = false;                           /* True once a slow switch has been caught, until the trace is dumped. */
+unsigned long DecisionCrossTime = 0;                    /* Time the raw RSSI of the other receiver last crossed above the selected one. */
+
+/* Trace injection. */
+boolean InjectListen = false;                           /* True whilst listening for a host asking for trace injection. */
+boolean InjectMode = false;                             /* True when RSSI readings come from the serial port instead of the ADC. */
+byte InjectMagicMatched = 0;                            /* Characters of "D4RI" received so far. */
+byte InjectBlock[2][TRACE_BLOCK_HEADER_BYTES + (2 * (TRACE_BLOCK_SAMPLES - 1)) + 1];    /* Double buffered injected trace blocks. */
+boolean InjectReady[2];                                 /* True when a block is complete and waiting to be used. */
+byte InjectFilling = 0;                                 /* Block being received. */
+int InjectFill = 0;                                     /* Bytes received into the block. */
+byte InjectUsing = 0;                                   /* Block samples are being taken from. */
+byte InjectPosition = 0;                                /* Next sample in the block. */
+unsigned int InjectSample[2];                           /* Injected readings for this pass. Index 0 = RX1, index 1 = RX2. */
+unsigned long InjectSampleCount = 0;                    /* Injected samples used, the timestamp sent back with switches. */
+unsigned long InjectListenStartTime = 0;                /* Time setup() finished, INJECT_LISTEN_MILLIS runs from here. */
+int InjectPreviousRxState = LOW;                        /* Receiver selected on the previous pass. */
+
+/* Bargraph. */
+int BargraphLevel = 0;                                  /* Displayed RSSI level, 0 to BARGRAPH_FULL_SCALE. */
+
+const byte BargraphGamma[256] PROGMEM = {               /* Linear brightness to PWM duty, gamma 2.2. */
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+
+/* Voltage. */
+float ADC_MAX = 1024.0;                                 /* Max ADC value. */
+float RSSIARef = 1.1;                                   /* Voltage of selected analogue reference. (see below, setup) Updated by BandgapUpdate(). */
+unsigned int BandgapBase = 0;                           /* Bandgap check when the RSSI limits were set, 0 = no check yet. */
+unsigned int RSSI1MinBase = 0;                          /* RSSI1Min when BandgapBase was taken. */
+unsigned int RSSI1MaxBase = 0;                          /* RSSI1Max when BandgapBase was taken. */
+unsigned int RSSI2MinBase = 0;                          /* RSSI2Min when BandgapBase was taken. */
+unsigned int RSSI2MaxBase = 0;                          /* RSSI2Max when BandgapBase was taken. */
+unsigned long BandgapPreviousTime = 0;                  /* Time of the last bandgap check. */
+byte BandgapState = BANDGAP_IDLE;                       /* Step of the check in progress. (see BandgapUpdate) */
+unsigned int BandgapSum = 0;                            /* Bandgap readings summed so far. */
+byte BandgapCount = 0;                                  /* Bandgap readings in BandgapSum. */
+unsigned long BandgapSettleTime = 0;                    /* Time the ADC went back on the RSSI reference. */
+float RSSI1Volts = 0;                                   /* Calculated voltage on RSSI pin. */
+float RSSI2Volts = 0;                                   /* Calculated voltage on RSSI pin. */
+
+/* Buttons. */
+int VideoControlPinState = LOW;                         /* The current state of the output pin. */
+int VideoSwitchCounter = 1;                             /* Counter for mode selection. */
+int VideoSwitchReading;                                 /* The current reading from the input pin. */
+int VideoSwitchPrevious = HIGH;                         /* The previous reading from the input pin. */
+long VideoSwitchTime = 0;                               /* The last time the output pin was toggled. */
+
+int RxControlPinState = LOW;                            /* The current state of the output pin. */
+int ModeSwitchCounter = 1;                              /* Counter for mode selection - 3 modes. (mode 1= rx1, mode 2= rx2, mode 3= diversity) */
+int ModeSwitchReading;                                  /* The current reading from the input pin. */
+long ModeSwitchTime = 0;                                /* The last time the output pin was toggled. */
+
+/* Start-up. */
+byte ResetCause = 0;                                    /* MCUSR at power up, tells a brown-out from a normal power up. */
+#if defined(__AVR__)
+byte BootloaderResetCause __attribute__ ((section (".noinit")));    /* MCUSR as handed over by optiboot in r2. (see SaveResetCause) */
+void SaveResetCause(void) __attribute__ ((naked, used, section (".init0")));
+#else
+byte BootloaderResetCause = 0;
+#endif
+unsigned long BootAnimationStartTime = 0;               /* Time the power up LED animation started. */
+int BootAnimationStep = 0;                              /* Next step of the power up LED animation. */
+boolean BootAnimationActive = true;                     /* True whilst the power up LED animation owns the LEDs. */
+int BannerStep = 0;                                     /* Next part of the debug banner to print. */
+boolean BannerActive = true;                            /* True whilst the debug banner is being printed. */
+
+/* Flags. */
+boolean DebugMode = false;                              /* State of debug mode. */
+boolean AutoRSSIMode = false;                           /* State of auto RSSI mode. */
+boolean MinRSSICalibrationFlag = false;                 /* False = fail, true = pass. */
+boolean MaxRSSICalibrationFlag = false;                 /* False = fail, true = pass. */
+boolean MinCalibRunOnce = false;
+boolean MaxCalibRunOnce = false;
+boolean RSSICalibrationCompleteFlag = false;            /* Set after both RSSI figures have been updated with on the fly values. */
+boolean OneTimeWarmupDelayFlag = true;                  /* True until one cycle of auto calibration of high RSSI has been attempted. */
+boolean CalibRetryDelayFlag = false;                    /* Initiate a delay before restarting Recalibration. */
+boolean RecalibrateButtonCheck = true;                  /* Check for a button press to initiate a recalibration cycle. */
+boolean Recalibrate = false;                            /* Enter Recalibration function. */
+boolean StartMinCal = false;
+boolean MinCalibrateButtonCheck = true;
+boolean StartMaxCal = false;
+boolean MaxCalibrateButtonCheck = true;
+
+
+/* Diversity. */
+unsigned long CounterPreviousDiversitySwitchTime = 0;   /* Time of the last receiver toggle. */
+int RSSI1PPrevious = 0;                                 /* RSSI % on the previous pass, for noise estimation. */
+int RSSI2PPrevious = 0;                                 /* RSSI % on the previous pass, for noise estimation. */
+long RSSI1NoiseSquared = 0;                             /* Smoothed square of pass to pass RSSI % change, x4096. */
+long RSSI2NoiseSquared = 0;                             /* Smoothed square of pass to pass RSSI % change, x4096. */
+int DiversityHysteresis = RSSI_HYSTERESIS;              /* Hysteresis in use, adapted to measured noise. */
+unsigned long DiversityIntervalMillis = DIVERSITY_INTERVAL_MIN_MILLIS;   /* Toggle time in use, adapted to measured noise. */
+int DiversityPolicy = DIVERSITY_POLICY;                 /* Policy for live video, can be stepped through from the serial console. */
+int DiversityPolicyActive = DIVERSITY_POLICY;           /* Policy in use, SPECTRUM_POLICY whilst the spectrum analyser is shown. */
+int DiversityScore[2] = {0, 0};                         /* Receiver scores compared by the diversity logic, %. Index 0 = RX1, index 1 = RX2. */
+int PolicyBonus[2] = {0, 0};                            /* Noise and trend terms of the score, %. */
+float PolicyBonusSmoothed[2] = {0, 0};                  /* PolicyBonus before rounding. */
+int PolicyTrendPrevious[2] = {0, 0};                    /* RSSI % at the last policy update, for the trend. */
+long PolicyVariance[2] = {0, 0};                        /* Smoothed square of ADC reading less RSSI average, x16. */
+unsigned long PolicyPreviousTime = 0;                   /* Time of the last policy update. */
+unsigned int AutoRSSICalLowLevel = 40;                  /* % RSSI FOR AUTO CAL. Default 30. */
+unsigned int AutoRSSICalHighLevel = 60;                 /* % RSSI FOR AUTO CAL. Default 70. */
+unsigned int RSSI1TempMin = 0;                          /* Used during auto calibration. */
+unsigned int RSSI1TempMax = 0;                          /* Used during auto calibration. */
+unsigned int RSSI2TempMin = 0;                          /* Used during auto calibration. */
+unsigned int RSSI2TempMax = 0;                          /* Used during auto calibration. */
+
+/* Calibration. */
+unsigned long CalibrationStartTime = 0;                 /* Time the current calibration stage started sampling. */
+unsigned int CalibrationSamples[2];                     /* Accepted samples. Index 0 = RX1, index 1 = RX2. */
+unsigned int CalibrationRejected[2];                    /* Samples rejected as outliers. */
+float CalibrationMean[2];                               /* Running mean of accepted samples. (Welford) */
+float CalibrationM2[2];                                 /* Running sum of squared differences from the mean. (Welford) */
+unsigned int CalibrationLow[2];                         /* Lowest accepted sample. */
+unsigned int CalibrationHigh[2];                        /* Highest accepted sample. */
+int CalibrationQuality = 0;                             /* Quality score of the last calibration stage, 0-100. */
+unsigned long CalibrationTimeoutCounter = 0;            /* Allow us to bail out of auto calibration if readings aren't within specification. */
+unsigned long RecalibrationOffsetCounter = 0;
+
+/* Antenna tracker. */
+unsigned long TrackerPreviousTime = 0;                  /* Time of the last control update. */
+unsigned long TrackerLossTime = 0;                      /* Last time the patch was on target. */
+int TrackerPosition = TRACKER_SERVO_CENTRE;             /* Servo pulse being sent, microseconds. */
+boolean TrackerMoving = false;                          /* True whilst the servo is held back by TRACKER_SLEW. */
+float TrackerAim = TRACKER_SERVO_CENTRE;                /* Integral term, where the rock is centred. */
+float TrackerSlope = 0;                                 /* Patch minus omni on the high side less the low side of the last rock. */
+int TrackerDifference = 0;                              /* Patch minus omni RSSI, 0.1% of calibrated range. */
+int TrackerDitherSide = 0;                              /* 0 = low side of the rock, 1 = high side. */
+int TrackerDitherCount = 0;                             /* Updates spent on the current side. */
+long TrackerDitherTotal[2] = {0, 0};                    /* Sum of TrackerDifference on each side. Index 0 = low side, index 1 = high side. */
+boolean TrackerScanning = false;                        /* True whilst sweeping to find the target. */
+int TrackerScanDirection = 1;                           /* 1 = sweeping up, -1 = sweeping down. */
+
+/* Loop timing. (PROFILE_BENCH) */
+unsigned long LoopPreviousMicros = 0;                   /* Start of the previous pass through the loop. */
+unsigned long LoopMicros = 0;                           /* Length of the previous pass through the loop. */
+unsigned long LoopMicrosMax = 0;                        /* Longest pass since the statistics were reset. */
+unsigned long LoopMicrosTotal = 0;                      /* Sum of passes since the statistics were reset. */
+unsigned long LoopCount = 0;                            /* Passes since the statistics were reset. */
+
+/* Link statistics. Index 0 = RX1, index 1 = RX2. */
+unsigned long StatsSamples[2];                          /* Number of samples taken since the last reset. */
+float StatsMean[2];                                     /* Running mean of average RSSI ADC readings. (Welford) */
+float StatsM2[2];                                       /* Running sum of squared differences from the mean. (Welford) */
+unsigned int StatsMin[2];                               /* Lowest average RSSI ADC reading seen. */
+unsigned int StatsMax[2];                               /* Highest average RSSI ADC reading seen. */
+unsigned long StatsHistogram[2][STATS_HISTOGRAM_BINS];  /* Count of samples falling in each RSSI bin. */
+unsigned long StatsSelectedMillis[2];                   /* Time this receiver has been feeding the video output. */
+boolean StatsInOutage[2];                               /* True whilst RSSI % is below STATS_OUTAGE_LEVEL. */
+unsigned long StatsOutageCount[2];                      /* Number of times RSSI % has dropped below STATS_OUTAGE_LEVEL. */
+unsigned long StatsOutageMillis[2];                     /* Total time spent below STATS_OUTAGE_LEVEL. */
+unsigned long StatsDiversityMillis = 0;                 /* Total time spent in diversity mode. */
+unsigned long StatsSwitchCount = 0;                     /* Number of receiver switches made by the diversity logic. */
+unsigned long StatsDwellStartTime = 0;                  /* Time of the last receiver switch. */
+unsigned long StatsLongestDwellMillis = 0;              /* Longest time spent on one receiver in diversity mode. */
+unsigned long StatsPreviousTime = 0;                    /* Time of the previous statistics update. */
+int StatsPreviousRxState = LOW;                         /* Receiver selected at the previous statistics update. */
+long StatsResetTime = 0;                                /* Debounce for the statistics reset button combination. */
+
+
+void setup() {
+
+    ResetCause = (MCUSR != 0) ? MCUSR : BootloaderResetCause;  /* Find out why we are starting. Optiboot clears MCUSR. */
+    MCUSR = 0;
+
+    pinMode(RX_CONTROL_PIN, OUTPUT);                    /* Get live video up first, everything else can wait. */
+    pinMode(VIDEO_CONTROL_PIN, OUTPUT);
+    digitalWrite(RX_CONTROL_PIN, LOW);                  /* Default RX module on start-up. */
+    digitalWrite(VIDEO_CONTROL_PIN, LOW);               /* Default screen (live video / spectrum analyser) on start-up. */
+
+    pinMode(RSSI1_ADC_PIN, INPUT);
+    pinMode(RSSI2_ADC_PIN, INPUT);
+
+    pinMode(MODE_SWITCH, INPUT_PULLUP);                 /* Hold during power up to enter debug mode. */
+    pinMode(VIDEO_SWITCH, INPUT_PULLUP);                /* Hold during power up to enter auto RSSI calibration mode mode. */
+                                                        /* Both buttons can be held simultaneously. */
+
+    pinMode(LED_RX_1, OUTPUT);
+    pinMode(LED_RX_2, OUTPUT);
+
+    pinMode(LED_025_P, OUTPUT);
+    pinMode(LED_050_P, OUTPUT);
+    pinMode(LED_075_P, OUTPUT);
+    pinMode(LED_100_P, OUTPUT);
+
+    pinMode(LED_DIVERSITY, OUTPUT);
+    pinMode(LED_HEARTBEAT, OUTPUT);
+
+    if(TRACKER_ENABLED == true)
+    {
+        TrackerSetup();                                 /* Servo frames start now, held at centre until RSSI is known. */
+    }
+
+
+    analogReference(RSSI_ADC_REFERENCE);
+    /* INTERNAL = Use internal 1V1 reference. */
+    /* DEFAULT  = Use supply voltage as reference. (3V3 / 5V) */
+    /* EXTERNAL = Use a voltage reference IC of your choice on the AREF pin. (EXAMPLE = FARNELL.COM:175-5111 / LM4040B20IDBZT) */
+    /* For EXTERNAL, the exact figure must be entered into "RSSIARef" in the Voltage section above to calculate correct debug info. */
+    /* INTERNAL and DEFAULT are checked against each other by BandgapUpdate(). */
+
+    BandgapStart();                           /* Take the reference the default limits hold against. */
+
+    if(BandgapHolding() == false)
+    {
+        RSSIAverageFill();                    /* Otherwise the loop fills them once AREF has settled. (see BandgapUpdate) */
+    }
+
+    StatsReset();                             /* Start link statistics from a clean slate. */
+
+
+    if (FEATURE_SERIAL == true && digitalRead(MODE_SWITCH) == 0)         /* Holding Mode switch enters DebugMode. */
+    {
+        DebugMode = true;
+    }
+
+    else
+    {
+        DebugMode = false;
+    }
+
+    if (FEATURE_CALIBRATION == true && digitalRead(VIDEO_SWITCH) == 0)   /* Holding Video switch enters RSSI calibration mode. */
+    {
+        AutoRSSIMode = true;
+    }
+
+    else
+    {
+        AutoRSSIMode = false;
+    }
+
+
+    if(FEATURE_SERIAL == false)
+    {
+        /* Do Nothing */                        /* Race build, serial port stays off. */
+    }
+
+    else if(DebugMode == true)
+    {
+        Serial.begin(19200);                    /* Start serial terminal if in debug mode. */
+    }
+
+    else if(FEATURE_INJECTION == true)
+    {
+        Serial.begin(INJECT_BAUD);              /* Give a bench host a moment to ask for trace injection. */
+        InjectListen = true;
+    }
+
+    else
+    {
+        /* Do Nothing */                        /* Serial port stays off until debug mode. */
+    }
+
+    /* The LED animation and debug banner are run by the loop, after live video is up. */
+    BootAnimationStartTime = millis();
+
+    if(ResetCause & _BV(BORF))
+    {
+        BootAnimationStep = BOOT_ANIMATION_STEPS;   /* Brown-out, we are probably in the air. Skip the show. */
+    }
+
+    if(AutoRSSIMode == true)                    /* Calibration holds on to the loop, finish the show first. */
+    {
+        while(BootAnimation() == true || PrintBanner() == true)
+        {
+            /* Do Nothing */
+        }
+
+        CalibrationTimeoutCounter = millis();   /* Calibration starts now. */
+    }
+
+    InjectListenStartTime = millis();           /* Not from power up, the boot animation and banner take their time. */
+}
+
+
+
+/******************************************************************************
+ SaveResetCause - Keep the reset cause optiboot hands over.
+
+Optiboot, as fitted to current Nanos, clears MCUSR before starting the sketch
+so setup() always reads 0 and can't see a brown-out. It passes the old value in
+r2 instead. This runs from .init0, before the C runtime touches r2, and keeps it
+in a .noinit variable. Older bootloaders leave MCUSR alone, so setup() only uses
+this copy when MCUSR reads 0.
+******************************************************************************/
+
+#if defined(__AVR__)
+void SaveResetCause(void)
+{
+    __asm__ __volatile__ ("sts %0, r2\n" : "=m" (BootloaderResetCause) :);
+}
+#endif
+
+
+
+/******************************************************************************
+ BootAnimation - Power up LED animation, one step at a time.
+
+Called every pass through the loop until it returns false, so the animation
+never holds up live video. The loop leaves the LEDs alone whilst it runs.
+******************************************************************************/
+
+boolean BootAnimation(void)
+{
+    if(BootAnimationStep >= BOOT_ANIMATION_STEPS)
+    {
+        return false;
+    }
+
+    if((millis() - BootAnimationStartTime) < ((unsigned long)BootAnimationStep * BOOT_ANIMATION_STEP_MILLIS))
+    {
+        return true;
+    }
+
+    switch(BootAnimationStep)
+    {
+        case 0:
+            digitalWrite(LED_025_P, HIGH);            /* flash some LEDs. */
+            break;
+
+        case 1:
+            digitalWrite(LED_050_P, HIGH);
+            break;
+
+        case 2:
+            digitalWrite(LED_075_P, HIGH);
+            break;
+
+        case 3:
+            digitalWrite(LED_100_P, HIGH);
+            break;
+
+        case 4:
+            digitalWrite(LED_RX_1, HIGH);
+            digitalWrite(LED_RX_2, HIGH);
+            digitalWrite(LED_DIVERSITY, HIGH);
+            break;
+
+        default:
+            digitalWrite(LED_025_P, LOW);
+            digitalWrite(LED_050_P, LOW);
+            digitalWrite(LED_075_P, LOW);
+            digitalWrite(LED_100_P, LOW);
+            digitalWrite(LED_RX_1, LOW);
+            digitalWrite(LED_RX_2, LOW);
+            digitalWrite(LED_DIVERSITY, LOW);
+            break;
+    }
+
+    BootAnimationStep++;
+
+    return (BootAnimationStep < BOOT_ANIMATION_STEPS);
+}
+
+
+
+/******************************************************************************
+ PrintBanner - Debug mode start-up banner, one part at a time.
+
+Called every pass through the loop until it returns false. A part is only
+printed once the serial transmit buffer has drained, so the banner never
+holds up live video. Loop debug output waits for the banner to finish.
+******************************************************************************/
+
+boolean PrintBanner(void)
+{
+    if(FEATURE_SERIAL == false || DebugMode == false)
+    {
+        return false;
+    }
+
+    if(Serial.availableForWrite() < (SERIAL_TX_BUFFER_SIZE - 1))
+    {
+        return true;     /* Still sending the previous part. */
+    }
+
+    switch(BannerStep)
+    {
+        case 0:
+            Serial.println(F(" "));
+            Serial.println(F(" "));
+            Serial.println(F("Div4RX5808-PRO"));
+            break;
+
+        case 1:
+            Serial.println(F("Dual 5.8GHz Video Receiver Diversity Controller with RX5808-PRO functionality."));
+            break;
+
+        case 2:
+            Serial.println(F("SlyMike"));
+            Serial.println(F(" "));
+            Serial.println(F(" "));
+            Serial.print(F(AUTHOR));
+            Serial.print(F(", V"));
+            Serial.print(F(INFO_MAJOR_VERSION));
+            Serial.print(F("."));
+            Serial.println(F(INFO_MINOR_VERSION));
+            break;
+
+        case 3:
+            Serial.print(F(COMPILE_DATE));
+            Serial.print(F(" - "));
+            Serial.println(F(COMPILE_TIME));
+            Serial.println(F(SOURCE_FILE));
+            break;
+
+        case 4:
+            Serial.print(F("Compiled with = "));
+            Serial.println(F(COMPILER));
+            Serial.print(F("Build profile = "));
+            Serial.print(F(BUILD_PROFILE_NAME));
+            Serial.print(F(", flash used = "));
+            Serial.print((uintptr_t)&__data_load_end);   /* End of code and initialised data in flash, as avr-size reports. */
+            Serial.println(F(" bytes"));
+            break;
+
+        case 5:
+            if(ResetCause & _BV(BORF))
+            {
+                Serial.println(F("BROWN-OUT RESET!"));
+            }
+
+            Serial.println(F(" "));
+            Serial.println(F("!!!DEBUG MODE!!!"));
+            Serial.println(F(" "));
+            break;
+
+        case 6:
+            if(AutoRSSIMode == true)
+            {
+                Serial.println(F("!!!AUTO RSSI CALIBRATION MODE!!!"));
+                Serial.println(F(" "));
+            }
+            break;
+
+        default:
+            return false;
+    }
+
+    BannerStep++;
+
+    return true;
+}
+
+
+
+/*******************************************************************************
+loop
+
+*******************************************************************************/
+void loop()
+{
+    digitalWrite(LED_HEARTBEAT, HIGH);
+
+    if(FEATURE_INSTRUMENTATION == true)
+    {
+        LoopTiming();
+    }
+
+    BootAnimationActive = BootAnimation();    /* Finish the start-up show whilst video is live. */
+    BannerActive = PrintBanner();
+
+    if(FEATURE_INJECTION == true && InjectListen == true)
+    {
+        InjectStart();
+    }
+
+
+
+    /*******************************************************************************
+    LINK STATISTICS RESET
+
+    Holding both buttons together resets the link statistics. Individual button
+    actions are held off whilst both buttons are down.
+    *******************************************************************************/
+
+
+
+    if((digitalRead(VIDEO_SWITCH) == LOW) && (digitalRead(MODE_SWITCH) == LOW))
+    {
+        if((millis() - StatsResetTime) > BUTTON_DEBOUNCE_MILLIS)
+        {
+            StatsReset();
+
+            if(FEATURE_SERIAL == true && DebugMode == true && TraceMode == false)
+            {
+                Serial.println(F("  "));
+                Serial.println(F("LINK STATISTICS RESET!"));
+            }
+        }
+
+        StatsResetTime = millis();
+        VideoSwitchTime = millis();
+        ModeSwitchTime = millis();
+    }
+
+
+
+    /*******************************************************************************
+    VIDEO TOGGLING SECTION
+
+    Selects video source on selected video receiver. Each receiver has two video
+    outputs, live video and spectrum analyser.
+    *******************************************************************************/
+
+
+
+    VideoSwitchReading = digitalRead(VIDEO_SWITCH);  /* Read the value of the video switch and save */
+
+if((VideoSwitchReading == LOW) && ((millis() - VideoSwitchTime) > BUTTON_DEBOUNCE_MILLIS))
+    {
+        VideoSwitchCounter++;
+
+        if(VideoSwitchCounter >= 3) /* Reset count if over max mode number */
+        {
+            VideoSwitchCounter = 1;
+        }
+
+        VideoSwitchTime = millis();
+    }
+
+
+
+    /******************************************************************************
+    MODE TOGGLING SECTION
+
+    EACH BUTTON PRESS SHOULD MOVE BETWEEN MODES 1-2-3-1-2-3.....
+    ******************************************************************************/
+
+
+
+    ModeSwitchReading = digitalRead(MODE_SWITCH); /* Read the value of the mode switch and save */
+
+    if((ModeSwitchReading == LOW) && ((millis() - ModeSwitchTime) > BUTTON_DEBOUNCE_MILLIS))
+    {
+        ModeSwitchCounter++;
+
+        if(ModeSwitchCounter >= 4) /* Reset count if over max mode number */
+        {
+            ModeSwitchCounter = 1;
+        }
+
+        ModeSwitchTime = millis();
+    }
+
+
+
+  /******************************************************************************
+    RSSI CALCULATIONS
+
+    RSSI figures need averaging, turning into a percentage and clipping.
+    ******************************************************************************/
+
+
+
+    if(FEATURE_INJECTION == true && InjectMode == true)
+    {
+        InjectNextSample();     /* Bench testing, RSSI comes from the host. */
+    }
+
+    else if(BandgapState != BANDGAP_IDLE)
+    {
+        BandgapUpdate();        /* Carry on the check, a step per pass. */
+    }
+
+    else if((millis() - BandgapPreviousTime) > BANDGAP_INTERVAL_MILLIS)
+    {
+        BandgapStart();         /* Follow drift of the ADC reference. */
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(BandgapHolding() == true)
+    {
+        /* Do Nothing, the ADC isn't on the RSSI reference. RSSI figures hold until it is. */
+    }
+
+    else
+    {
+        if(RSSIAverageFilled == false)
+        {
+            RSSIAverageFill();      /* First readings since power up. */
+        }
+
+        RSSIPairRead();             /* Both receivers, sampled at the same moment. */
+
+        RSSI1Total = RSSI1Total - RSSI1Readings[RSSI1ReadIndex];
+        RSSI1Readings[RSSI1ReadIndex] = RSSI1InputPinValue;
+        RSSI1Total = RSSI1Total + RSSI1Readings[RSSI1ReadIndex];
+        RSSI1ReadIndex = RSSI1ReadIndex + 1;
+
+        if(RSSI1ReadIndex >= MAX_AVERAGE_READINGS)
+        {
+            RSSI1ReadIndex = 0;
+        }
+
+        RSSI1Average = RSSI1Total / MAX_AVERAGE_READINGS;
+
+        RSSI2Total = RSSI2Total - RSSI2Readings[RSSI2ReadIndex];
+        RSSI2Readings[RSSI2ReadIndex] = RSSI2InputPinValue;
+        RSSI2Total = RSSI2Total + RSSI2Readings[RSSI2ReadIndex];
+        RSSI2ReadIndex = RSSI2ReadIndex + 1;
+
+        if(RSSI2ReadIndex >= MAX_AVERAGE_READINGS)
+        {
+            RSSI2ReadIndex = 0;
+        }
+
+        RSSI2Average = RSSI2Total / MAX_AVERAGE_READINGS;
+
+        RSSI1P = map(RSSI1Average, RSSI1Min, RSSI1Max, 0, 100);
+        RSSI2P = map(RSSI2Average, RSSI2Min, RSSI2Max, 0, 100);
+
+        /* Clip erroneous values to within 0%-100% range. Readings outside the calibrated limits would otherwise give negative or >100% figures. */
+        if(RSSI1P < 0)
+        {
+            RSSI1P = 0;
+        }
+
+        else if(RSSI1P > 100)
+        {
+            RSSI1P = 100;
+        }
+
+        else
+        {
+            /* Do Nothing */
+        }
+
+        if(RSSI2P < 0)
+        {
+            RSSI2P = 0;
+        }
+
+        else if(RSSI2P > 100)
+        {
+            RSSI2P = 100;
+        }
+
+        else
+        {
+            /* Do Nothing */
+        }
+
+        UpdateRSSINoise();  /* Adapt diversity hysteresis and toggle time to receiver noise. */
+        UpdateDiversityPolicy();    /* Pick the diversity policy, update its noise and trend terms. */
+
+        HealthCheck(0, LatestReading(RSSI1Readings, RSSI1ReadIndex));   /* Look for dead or disconnected receivers. */
+        HealthCheck(1, LatestReading(RSSI2Readings, RSSI2ReadIndex));
+
+        /* Calculate voltages of RSSI pins. */
+        RSSI1Volts = (RSSI1InputPinValue / ADC_MAX) * RSSIARef;
+        RSSI2Volts = (RSSI2InputPinValue / ADC_MAX) * RSSIARef;
+    }
+
+
+
+    /******************************************************************************
+    AUTOMATIC RSSI CALIBRATION
+
+    If the flag was set during setup, we will jump to the calibration loop to
+    attempt auto calibration.
+    We will either be successful or a "time-out" will occur.
+    ******************************************************************************/
+
+
+
+    while(FEATURE_CALIBRATION == true && AutoRSSIMode == true && BandgapHolding() == false) /* Video button was held during power up (pulled low) */
+    {
+        Calibrate();            /* Jump to calibration loop. */
+    }
+
+
+
+    /******************************************************************************
+    LED CONTROL SECTION
+
+    LEDs must be driven appropriately to display active video receiver
+    and RSSI levels.
+
+    Mode 1 selects video receiver one, Mode 2 selects video receiver 2 and mode 3
+    selects the receiver with the highest RSSI value. The RSSI value is read
+    with each pass through the loop and the receiver with the highest value is
+    selected.
+    ******************************************************************************/
+
+
+
+    if(BootAnimationActive == false)    /* LEDs belong to the start-up animation until it is done. */
+    {
+        digitalWrite(LED_RX_1, HealthLED(0, (RxControlPinState == LOW)));       /* When "RxControlPinState" is low the rx1 led will illuminate. Place this led next to RX1 antenna */
+        digitalWrite(LED_RX_2, HealthLED(1, (!(RxControlPinState == LOW))));    /* When "RxControlPinState" is high the rx2 led will illuminate. Place this led next to RX2 antenna */
+
+        /* Smoothly display RSSI on four LEDs */
+
+        if(RxControlPinState == LOW)
+        {
+            DisplayBargraph(RSSI1Average, RSSI1Min, RSSI1Max);
+        }
+
+        else
+        {
+            DisplayBargraph(RSSI2Average, RSSI2Min, RSSI2Max);
+        }
+    }
+
+    digitalWrite(LED_HEARTBEAT, LOW); // TODO MD 20150317 Clean this up and make it work better.
+
+
+
+    /******************************************************************************
+    MODE SPECIFIC ACTIONS
+
+    Physical pins are toggled in accordance with mode selection.
+    In diversity mode a timer is present to stop "thrashing" of the receiver
+    selection pin thus reducing screen flicker.
+
+    The other receiver is only selected once its score beats the current
+    receiver by the hysteresis, and only once the toggle time has passed since
+    the last toggle. Both are adapted to the measured RSSI noise by
+    UpdateRSSINoise(), between "RSSI_HYSTERESIS" / "RSSI_HYSTERESIS_MAX" and
+    "DIVERSITY_INTERVAL_MIN_MILLIS" / "DIVERSITY_INTERVAL_MILLIS". The policy in
+    use scores the receivers and picks one, see DiversityDecide(). Under
+    POLICY_FREEZE, the default whilst the spectrum analyser is shown, receivers
+    are not switched on RSSI. A receiver that HealthCheck() has found faulty is
+    dropped at once if the other receiver is healthy, without waiting for the
+    toggle time.
+    ******************************************************************************/
+
+
+    /* Video button. Switches between live video and spectrum analyser output.*/
+    if(VideoSwitchCounter == 1)
+    {
+        VideoControlPinState = LOW;
+    }
+
+    else if(VideoSwitchCounter == 2)
+    {
+        VideoControlPinState = HIGH;
+    }
+
+    digitalWrite(VIDEO_CONTROL_PIN, VideoControlPinState);
+
+    /* Mode button. */
+    unsigned long CounterCurrentDiversitySwitchTime = millis();
+    unsigned long elapsed = CounterCurrentDiversitySwitchTime - CounterPreviousDiversitySwitchTime;
+
+    if(BootAnimationActive == false)
+    {
+        digitalWrite(LED_DIVERSITY, (ModeSwitchCounter >= 3));
+    }
+
+    if(ModeSwitchCounter == 1)
+    {
+        RxControlPinState = LOW;
+    }
+
+    else if(ModeSwitchCounter == 2)
+    {
+        RxControlPinState = HIGH;
+    }
+
+    else if(ModeSwitchCounter == 3)
+    {
+        //digitalWrite(LED_DIVERSITY, HIGH); /* Display diversity mode */
+        // lets see if "digitalWrite(LED_DIVERSITY, (ModeSwitchCounter >= 3));" will do the trick. MD
+
+        int DecisionPreviousRxState = RxControlPinState;
+        int Wanted = DiversityDecide(RxControlPinState, elapsed);      /* Receiver the policy in use picks. */
+
+        if(HealthFault[0] != HEALTH_OK && HealthFault[1] == HEALTH_OK)        /* Quarantine RX1. */
+        {
+            Wanted = HIGH;
+        }
+
+        else if(HealthFault[1] != HEALTH_OK && HealthFault[0] == HEALTH_OK)   /* Quarantine RX2. */
+        {
+            Wanted = LOW;
+        }
+
+        else
+        {
+            /* Do Nothing */
+        }
+
+        if(Wanted != RxControlPinState)
+        {
+            RxControlPinState = Wanted;
+            CounterPreviousDiversitySwitchTime = CounterCurrentDiversitySwitchTime;
+        }
+
+        if(FEATURE_SERIAL == true && DebugMode == true)
+        {
+            DecisionRecord(DecisionPreviousRxState, elapsed);   /* Why we did, or didn't, switch. */
+        }
+    }
+
+    else
+    {
+    /* Do Nothing */
+    }
+
+    digitalWrite(RX_CONTROL_PIN, RxControlPinState);
+
+    if(FEATURE_SERIAL == true)
+    {
+        StatsUpdate();      /* Fold this pass into the link statistics. */
+    }
+
+    if(FEATURE_INJECTION == true && InjectMode == true && RxControlPinState != InjectPreviousRxState)
+    {
+        InjectSwitch();     /* Tell the bench host about the switch. */
+    }
+
+    InjectPreviousRxState = RxControlPinState;
+
+
+
+    /******************************************************************************
+    ANTENNA TRACKER
+
+    Steers the patch antenna at a fixed rate, see TrackerUpdate(). Updates are
+    scheduled from millis() so the rate doesn't follow the loop. Updates missed
+    by a stall (calibration, debug text) are dropped, not caught up back to
+    back, so the servo never moves faster than TRACKER_SLEW per
+    TRACKER_INTERVAL_MILLIS. The servo pulse is made by Timer1 so it never
+    jitters with the loop.
+    ******************************************************************************/
+
+
+
+    if(TRACKER_ENABLED == true && (millis() - TrackerPreviousTime) >= TRACKER_INTERVAL_MILLIS)
+    {
+        if((millis() - TrackerPreviousTime) >= (2 * TRACKER_INTERVAL_MILLIS))
+        {
+            TrackerPreviousTime = millis();     /* Fell behind, start again from now. */
+        }
+
+        else
+        {
+            TrackerPreviousTime += TRACKER_INTERVAL_MILLIS;
+        }
+
+        TrackerUpdate();
+    }
+
+
+
+    /******************************************************************************
+    SERIAL DEBUG MESSAGES
+
+    Display values in serial console when in serial debug mode.
+    PROFILE_BENCH adds the raw readings, voltages, limits and loop time.
+    ******************************************************************************/
+
+
+
+    if(FEATURE_SERIAL == true && DebugMode == true && BannerActive == false && TraceMode == false && QuietMode == false)
+    {
+
+    /* RSSI 1. */
+
+        if(FEATURE_INSTRUMENTATION == true)
+        {
+            Serial.print(F("  RSSI1 ="));
+            Serial.print(RSSI1InputPinValue);
+        }
+
+        Serial.print(F("  RSSI1_AVERAGE ="));
+        Serial.print(RSSI1Average);
+
+        Serial.print(F("  RSSI1% ="));
+        Serial.print(RSSI1P);
+
+        if(FEATURE_INSTRUMENTATION == true)
+        {
+            Serial.print(F("  RSSI1Volts ="));
+            Serial.print(RSSI1Volts);
+
+            Serial.print(F("  RSSI1 MIN/MAX ="));
+            Serial.print(RSSI1Min);
+            Serial.print(F("/"));
+            Serial.print(RSSI1Max);
+        }
+
+
+    /* RSSI 2. */
+
+        if(FEATURE_INSTRUMENTATION == true)
+        {
+            Serial.print(F("  RSSI2 ="));
+            Serial.print(RSSI2InputPinValue);
+        }
+
+        Serial.print(F("  RSSI2_AVERAGE ="));
+        Serial.print(RSSI2Average);
+
+        Serial.print(F("  RSSI2% ="));
+        Serial.print(RSSI2P);
+
+        if(FEATURE_INSTRUMENTATION == true)
+        {
+            Serial.print(F("  RSSI2Volts ="));
+            Serial.print(RSSI2Volts);
+
+            Serial.print(F("  RSSI2 MIN/MAX ="));
+            Serial.print(RSSI2Min);
+            Serial.print(F("/"));
+            Serial.print(RSSI2Max);
+        }
+
+
+    /* Switches. */
+
+        Serial.print(F("  VIDEO ="));                  /* Live video / Spectrum analyser switch */
+        Serial.print(VideoControlPinState);
+
+        Serial.print(F("  MODE ="));                   /* Current mode (3 IS DIVERSITY) */
+        Serial.print(ModeSwitchCounter);
+
+        Serial.print(F("  RX ="));                     /* state of video RX selector pin. */
+        Serial.println(RxControlPinState);
+
+        Serial.print(F("  Elapsed "));               /* Time since RX modules were toggled. */
+        Serial.print(elapsed);
+
+        Serial.print(F("  Health "));                /* Receiver faults, 0 = OK. */
+        Serial.print(HealthFault[0]);
+        Serial.print(F("/"));
+        Serial.print(HealthFault[1]);
+
+        Serial.print(F("  Hyst "));                  /* Adapted hysteresis and toggle time. */
+        Serial.print(DiversityHysteresis);
+        Serial.print(F("/"));
+        Serial.print(DiversityIntervalMillis);
+
+        Serial.print(F("  Policy "));                /* Policy in use and receiver scores. */
+        Serial.print(DiversityPolicyActive);
+        Serial.print(F(" "));
+        Serial.print(DiversityScore[0]);
+        Serial.print(F("/"));
+        Serial.print(DiversityScore[1]);
+
+        Serial.print(F("  AutoCal "));
+        Serial.print(RSSICalibrationCompleteFlag);
+
+        if(TRACKER_ENABLED == true)
+        {
+            Serial.print(F("  Tracker "));            /* Servo pulse / patch minus omni / scanning. */
+            Serial.print(TrackerPosition);
+            Serial.print(F("/"));
+            Serial.print(TrackerDifference);
+            Serial.print(F("/"));
+            Serial.print(TrackerScanning);
+        }
+
+        if(FEATURE_INSTRUMENTATION == true)
+        {
+            Serial.print(F("  Loop us "));         /* Previous pass, including this output. */
+            Serial.print(LoopMicros);
+        }
+
+    }
+
+
+
+    /******************************************************************************
+    SERIAL COMMANDS
+
+    Single character commands from the serial console when in serial debug mode.
+    Whilst a trace is running only the trace toggle is accepted so the binary
+    stream isn't broken up by text.
+    ******************************************************************************/
+
+
+
+    if(FEATURE_SERIAL == true && DebugMode == true && BannerActive == false)
+    {
+        if(Serial.available() > 0)
+        {
+            int SerialCommand = Serial.read();
+
+            if(SerialCommand == TRACE_SERIAL_TOGGLE)
+            {
+                if(TraceMode == false)
+                {
+                    TraceStart();
+                }
+
+                else
+                {
+                    TraceStop();
+                }
+            }
+
+            else if(TraceMode == true)
+            {
+                /* Do Nothing */
+            }
+
+            else if(SerialCommand == STATS_SERIAL_QUERY)
+            {
+                StatsPrint();
+            }
+
+            else if(SerialCommand == POLICY_SERIAL_CYCLE)
+            {
+                DiversityPolicy = (DiversityPolicy + 1) % POLICY_COUNT;
+                Serial.println(F("  "));
+                Serial.print(F("DIVERSITY POLICY "));
+                Serial.println(DiversityPolicy);
+            }
+
+            else if(SerialCommand == DECISION_SERIAL_DUMP)
+            {
+                DecisionDump();
+            }
+
+            else if(SerialCommand == DECISION_SERIAL_QUIET)
+            {
+                QuietMode = !QuietMode;
+            }
+
+            else if(SerialCommand == STATS_SERIAL_RESET)
+            {
+                StatsReset();
+                Serial.println(F("  "));
+                Serial.println(F("LINK STATISTICS RESET!"));
+            }
+
+            else
+            {
+                /* Do Nothing */
+            }
+        }
+
+        if(TraceMode == true && BandgapHolding() == false && (millis() - TracePreviousTime) >= TRACE_INTERVAL_MILLIS)
+        {
+            if((millis() - TracePreviousTime) >= (2 * TRACE_INTERVAL_MILLIS))
+            {
+                TracePreviousTime = millis();   /* Fell behind, drop the missed samples rather than send them late. */
+            }
+
+            else
+            {
+                TracePreviousTime += TRACE_INTERVAL_MILLIS;
+            }
+
+            TraceSample(LatestReading(RSSI1Readings, RSSI1ReadIndex), LatestReading(RSSI2Readings, RSSI2ReadIndex));
+        }
+    }
+}
+
+
+
+/******************************************************************************
+Calibrate - AUTOMATIC RSSI CALIBRATION LOOP
+
+Attempt to auto calibrate RSSI levels by sampling the RSSI of each video
+receiver until its mean is known to within CALIB_CONFIDENCE ADC steps, or until
+CALIB_MAX_MILLIS has passed. Spikes are rejected as outliers. Readings must be
+below 40% (TX off), this becomes the MIN RSSI value for each video receiver.
+Set the first calibration flag.
+Sample again with the TX on, readings must be above 60%, this becomes the MAX
+RSSI value for each video receiver. Set the second calibration flag.
+A stage is failed and must be restarted with the button if the quality score is
+poor or the two receivers disagree by more than CALIB_MAX_DISAGREEMENT.
+Check that both the MIN and MAX flags have been set, set the calibration done
+flag and apply temp settings as RSSI MIN and MAX values, flash appropriate
+LED and set the calibration complete flag. Show serial messages as appropriate.
+
+NOTE:
+Video channel must be selected on both RX units prior to attempting Auto
+Calibration.
+
+Turn on diversity receiver in Auto Calibration Mode by holding the "Video"
+button during power up, amber LED will illuminate whilst Min RSSI values
+are being calculated, turn on transmitter, a second amber led will illuminate
+as Max RSSI is being calculated.
+
+If Automatic RSSI calibration is successful the green LED will illuminate.
+The red LED indicates failure to calibrate.
+
+In the event that calibration is unsuccessful the default values will be
+applied and the unit will return to normal operation.
+
+If calibration is successful, calculated values will remain active until unit
+is turned off.
+
+Auto Calibration RSSI values ARE NOT saved to EEPROM!
+Directional antennas MUST be pointed at TX module during calibration!
+Make sure NO ONE else is broadcasting on the same channel prior to Calibration!
+YOU are solely responsible for the operation of YOUR equipment!
+******************************************************************************/
+
+void Calibrate(void)
+{
+    while(MinRSSICalibrationFlag == false && CalibrationTimedOut() == false)   /* Jump to min calibration until flag changes, at this point we have temp figures to apply later. */
+    {
+        CalibrateMin();         /* Jump to Min calibration loop. */
+    }
+
+    while(MaxRSSICalibrationFlag == false && CalibrationTimedOut() == false)   /* Jump to max calibration until flag changes, at this point we have temp figures to apply later. */
+    {
+        CalibrateMax();         /* Jump to Max calibration loop. */
+    }
+
+    if(MinRSSICalibrationFlag == true && MaxRSSICalibrationFlag == true)     /* Calibration successful. */
+    {
+        RSSI1Min = RSSI1TempMin; /* Save temp value as new min RSSI value */
+        RSSI2Min = RSSI2TempMin; /* Save temp value as new min RSSI value */
+        RSSI1Max = RSSI1TempMax; /* Save temp value as new max RSSI value */
+        RSSI2Max = RSSI2TempMax; /* Save temp value as new max RSSI value */
+
+        BandgapBase = 0;         /* New limits, take the reference they were measured against as the base. */
+        BandgapStart();
+
+        digitalWrite(LED_100_P, HIGH);         /* Green light, good job!! */
+        RSSICalibrationCompleteFlag = true;    /* Flag set, Calibration successful, we wont try calibration again! */
+        AutoRSSIMode = false;                  /* Flag set, we wont be coming back into calibration loop again! */
+
+        if(DebugMode == true)
+        {
+            Serial.println(F("  "));
+            Serial.println(F("AUTO RSSI CALIBRATION COMPLETE, NEW SETTINGS APPLIED!"));
+            Serial.print(F("RSSI1 MIN / MAX = "));
+            Serial.print(RSSI1Min);
+            Serial.print(F(" / "));
+            Serial.println(RSSI1Max);
+            Serial.print(F("RSSI2 MIN / MAX = "));
+            Serial.print(RSSI2Min);
+            Serial.print(F(" / "));
+            Serial.println(RSSI2Max);
+            Serial.println(F("Restarting using calculated values...."));
+        }
+        delay(2500);
+
+    }
+
+    else                        /* Timed out, carry on with the limits we already have. */
+    {
+        digitalWrite(LED_050_P, LOW);
+        digitalWrite(LED_075_P, LOW);
+        digitalWrite(LED_025_P, HIGH);         /* Red light, calibration failed. */
+        AutoRSSIMode = false;                  /* Flag set, we wont be coming back into calibration loop again! */
+
+        if(DebugMode == true)
+        {
+            Serial.println(F("  "));
+            Serial.println(F("AUTO RSSI CALIBRATION TIMED OUT, KEEPING PREVIOUS SETTINGS!"));
+        }
+        delay(2500);
+    }
+
+}
+
+
+
+/******************************************************************************
+ CalibrationTimedOut - True once CALIB_TIMEOUT_MILLIS has passed since
+ calibration started.
+******************************************************************************/
+
+boolean CalibrationTimedOut(void)
+{
+    return ((millis() - CalibrationTimeoutCounter) > CALIB_TIMEOUT_MILLIS);
+}
+
+void CalibrateMin (void)
+{
+
+    /* do nothing until a button press is sensed, find the average, save it as a temp value, */
+
+
+
+        if(MinCalibrateButtonCheck == true)    /* Only check for button press once. */
+        {
+            if(digitalRead(MODE_SWITCH) == 0)
+            {
+                StartMinCal = true;
+                MinCalibrateButtonCheck = false;       /* we must successfully jump to recalibration loop if we ever want this to toggle true again. sanity check. */
+
+                if(DebugMode == true)
+                    {
+                        Serial.println(F("Attempting Min calibration...."));
+                    }
+            }
+        }
+
+
+        if(MinRSSICalibrationFlag == false && StartMinCal == false)
+        {
+            /* We are waiting for a button press to start calibration. */
+            /* Flash an LED and spit out serial debug whilst waiting. */
+            /* We will be stuck here until a button is pressed or a time-out occurs. */
+            return;
+        }
+
+
+    if(MinCalibRunOnce == false)
+    {
+        digitalWrite(LED_025_P, LOW);
+        digitalWrite(LED_050_P, HIGH);     /* Indicate that we are in LOW calibration mode. */
+        CalibrationReset();
+        MinCalibRunOnce = true;
+    }
+
+    CalibrationSample();
+
+    if(CalibrationFinished() == false)
+    {
+        return;     /* Keep sampling. */
+    }
+
+    /* Make sure we're under 40% (if the AREF was set-up properly, this is a reasonable figure) */
+    /* We are assuming that transmitters are turned off and receivers are tuned correctly at this point. */
+    /* Fail Auto Calibrate if both receivers ARE NOT showing values of less than 40% RSSI. */
+    if(CalibrationAccepted() == true &&
+       map(CalibrationMean[0], RSSI1Min, RSSI1Max, 0, 100) <= (long)AutoRSSICalLowLevel &&
+       map(CalibrationMean[1], RSSI2Min, RSSI2Max, 0, 100) <= (long)AutoRSSICalLowLevel)
+    {
+        RSSI1TempMin = CalibrationMean[0] + 0.5;
+        RSSI2TempMin = CalibrationMean[1] + 0.5;
+        MinRSSICalibrationFlag = true; /* Set the Min calibration flag to "done" (true) so that the above statements get ignored next time through the loop */
+
+        if(DebugMode == true)
+        {
+            Serial.println(F("MIN RSSI CALIBRATION COMPLETE!"));
+            CalibrationPrint();
+        }
+    }
+
+    else
+    {
+        /* We have an error condition, the RSSI is too high or unstable. Wait for another button press. */
+        CalibrationFailed();
+        StartMinCal = false;
+        MinCalibrateButtonCheck = true;
+        MinCalibRunOnce = false;
+    }
+
+    CalibrationWaitForRelease();
+}
+
+void CalibrateMax (void)
+{
+
+    /* do nothing until a button press is sensed, find the average, save it as a temp value, */
+
+
+
+        if(MaxCalibrateButtonCheck == true)    /* Only check for button press once. */
+        {
+            if(digitalRead(MODE_SWITCH) == 0)
+            {
+                StartMaxCal = true;
+                MaxCalibrateButtonCheck = false;       /* we must successfully jump to recalibration loop if we ever want this to toggle true again. sanity check. */
+
+                if(DebugMode == true)
+                    {
+                        Serial.println(F("Attempting Max calibration...."));
+                    }
+            }
+        }
+
+
+        if(MaxRSSICalibrationFlag == false && StartMaxCal == false)
+        {
+            /* We are waiting for a button press to start calibration. */
+            /* Flash an LED and spit out serial debug whilst waiting. */
+            /* We will be stuck here until a button is pressed or a time-out occurs. */
+            return;
+        }
+
+
+    if(MaxCalibRunOnce == false)
+    {
+        digitalWrite(LED_025_P, LOW);
+        digitalWrite(LED_075_P, HIGH);     /* Indicate that we are in HIGH calibration mode. */
+        CalibrationReset();
+        MaxCalibRunOnce = true;
+    }
+
+    CalibrationSample();
+
+    if(CalibrationFinished() == false)
+    {
+        return;     /* Keep sampling. */
+    }
+
+    if(CalibrationAccepted() == true &&
+       map(CalibrationMean[0], RSSI1Min, RSSI1Max, 0, 100) >= (long)AutoRSSICalHighLevel &&
+       map(CalibrationMean[1], RSSI2Min, RSSI2Max, 0, 100) >= (long)AutoRSSICalHighLevel)     /* Make sure we're over 60% (TX ON and tuned) for both RX units. */
+    {
+        RSSI1TempMax = CalibrationMean[0] + 0.5;
+        RSSI2TempMax = CalibrationMean[1] + 0.5;
+        MaxRSSICalibrationFlag = true; /* Set the Max calibration flag to "done" (true) so that the above get ignored next time through the loop */
+
+        if(DebugMode == true)
+        {
+            Serial.println(F("MAX RSSI CALIBRATION COMPLETE!"));
+            CalibrationPrint();
+        }
+    }
+
+    else
+    {
+        /* We have an error condition, the RSSI is too low or unstable. Wait for another button press. */
+        CalibrationFailed();
+        StartMaxCal = false;
+        MaxCalibrateButtonCheck = true;
+        MaxCalibRunOnce = false;
+    }
+
+    CalibrationWaitForRelease();
+}
+
+
+
+/******************************************************************************
+ CalibrationReset - Clear the calibration sample distribution.
+******************************************************************************/
+
+void CalibrationReset(void)
+{
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        CalibrationSamples[Rx] = 0;
+        CalibrationRejected[Rx] = 0;
+        CalibrationMean[Rx] = 0;
+        CalibrationM2[Rx] = 0;
+        CalibrationLow[Rx] = 1023;
+        CalibrationHigh[Rx] = 0;
+    }
+
+    CalibrationStartTime = millis();
+}
+
+
+
+/******************************************************************************
+ CalibrationSample - Add one fresh reading of each RSSI to the distribution.
+
+The ADC is read directly as the loop averages are not updated whilst
+calibrating, through RSSIPairRead() so the limits are taken with the same ADC
+clock and settling as the readings they will scale. Once CALIB_MIN_SAMPLES
+have been taken, readings further than CALIB_OUTLIER_SIGMA standard deviations
+from the mean are counted and rejected so that a single spike can't move the
+result.
+******************************************************************************/
+
+void CalibrationSample(void)
+{
+    unsigned int Sample[2];
+
+    RSSIPairRead();
+    Sample[0] = RSSI1InputPinValue;
+    Sample[1] = RSSI2InputPinValue;
+
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        float Delta = Sample[Rx] - CalibrationMean[Rx];
+
+        if(CalibrationSamples[Rx] >= CALIB_MIN_SAMPLES)
+        {
+            float Limit = CALIB_OUTLIER_SIGMA * sqrt(CalibrationM2[Rx] / (CalibrationSamples[Rx] - 1));
+
+            if(Limit < CALIB_OUTLIER_SIGMA)
+            {
+                Limit = CALIB_OUTLIER_SIGMA;    /* Don't reject everything on a perfectly quiet signal. */
+            }
+
+            if(Delta > Limit || Delta < -Limit)
+            {
+                CalibrationRejected[Rx]++;
+                continue;
+            }
+        }
+
+        CalibrationSamples[Rx]++;
+        CalibrationMean[Rx] += Delta / CalibrationSamples[Rx];
+        CalibrationM2[Rx] += Delta * (Sample[Rx] - CalibrationMean[Rx]);
+
+        if(Sample[Rx] < CalibrationLow[Rx])
+        {
+            CalibrationLow[Rx] = Sample[Rx];
+        }
+
+        if(Sample[Rx] > CalibrationHigh[Rx])
+        {
+            CalibrationHigh[Rx] = Sample[Rx];
+        }
+    }
+}
+
+
+
+/******************************************************************************
+ CalibrationFinished - True once calibration sampling can stop.
+
+Stops as soon as the 95% confidence interval on both means is within
+CALIB_CONFIDENCE, or when CALIB_MAX_MILLIS has passed. Updates the quality score,
+100 if the confidence was reached, less if time ran out first, and reduced by
+the percentage of samples rejected as outliers.
+******************************************************************************/
+
+boolean CalibrationFinished(void)
+{
+    float WorstInterval = 0;
+    int RejectedPercent = 0;
+
+    if(CalibrationSamples[0] < CALIB_MIN_SAMPLES || CalibrationSamples[1] < CALIB_MIN_SAMPLES)
+    {
+        if((millis() - CalibrationStartTime) < CALIB_MAX_MILLIS)
+        {
+            return false;
+        }
+
+        CalibrationQuality = 0;     /* Too few good samples to trust. */
+        return true;
+    }
+
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        float Interval = 1.96 * sqrt(CalibrationM2[Rx] / (CalibrationSamples[Rx] - 1) / CalibrationSamples[Rx]);
+        int Rejected = 100L * CalibrationRejected[Rx] / (CalibrationSamples[Rx] + CalibrationRejected[Rx]);
+
+        if(Interval > WorstInterval)
+        {
+            WorstInterval = Interval;
+        }
+
+        if(Rejected > RejectedPercent)
+        {
+            RejectedPercent = Rejected;
+        }
+    }
+
+    if(WorstInterval > CALIB_CONFIDENCE && (millis() - CalibrationStartTime) < CALIB_MAX_MILLIS)
+    {
+        return false;
+    }
+
+    CalibrationQuality = 100 - RejectedPercent;
+
+    if(WorstInterval > CALIB_CONFIDENCE)
+    {
+        CalibrationQuality = CalibrationQuality * CALIB_CONFIDENCE / WorstInterval;
+    }
+
+    return true;
+}
+
+
+
+/******************************************************************************
+ CalibrationAccepted - True if a finished calibration stage can be used.
+******************************************************************************/
+
+boolean CalibrationAccepted(void)
+{
+    float Disagreement = CalibrationMean[0] - CalibrationMean[1];
+
+    if(CalibrationQuality < CALIB_MIN_QUALITY)
+    {
+        return false;
+    }
+
+    if(Disagreement > CALIB_MAX_DISAGREEMENT || Disagreement < -CALIB_MAX_DISAGREEMENT)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+
+/******************************************************************************
+ CalibrationFailed - Show that a calibration stage failed.
+
+Red LED, the stage must be restarted with another button press.
+******************************************************************************/
+
+void CalibrationFailed(void)
+{
+    digitalWrite(LED_050_P, LOW);
+    digitalWrite(LED_075_P, LOW);
+    digitalWrite(LED_025_P, HIGH);         /* Red light, try again. */
+
+    if(DebugMode == true)
+    {
+        Serial.println(F("RSSI CALIBRATION FAILED! PRESS MODE TO RETRY."));
+        CalibrationPrint();
+    }
+}
+
+
+
+/******************************************************************************
+ CalibrationPrint - Show the calibration sample distribution.
+******************************************************************************/
+
+void CalibrationPrint(void)
+{
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        Serial.print(F("RSSI"));
+        Serial.print(Rx + 1);
+        Serial.print(F(" = "));
+        Serial.print(CalibrationMean[Rx]);
+        Serial.print(F("  STDDEV = "));
+        Serial.print((CalibrationSamples[Rx] > 1) ? sqrt(CalibrationM2[Rx] / (CalibrationSamples[Rx] - 1)) : 0.0);
+        Serial.print(F("  LOW / HIGH = "));
+        Serial.print(CalibrationLow[Rx]);
+        Serial.print(F(" / "));
+        Serial.print(CalibrationHigh[Rx]);
+        Serial.print(F("  SAMPLES = "));
+        Serial.print(CalibrationSamples[Rx]);
+        Serial.print(F("  REJECTED = "));
+        Serial.println(CalibrationRejected[Rx]);
+    }
+
+    Serial.print(F("QUALITY = "));
+    Serial.print(CalibrationQuality);
+    Serial.print(F("  TIME MS = "));
+    Serial.println(millis() - CalibrationStartTime);
+}
+
+
+
+/******************************************************************************
+ CalibrationWaitForRelease - Wait for the mode button to be let go.
+
+Calibration finishes in well under a second, so the button that started a
+stage may still be held. Waiting stops it starting the next stage too.
+The contacts bounce as they open, and the next stage reads the pin directly
+with none of the loop's debounce, so BUTTON_DEBOUNCE_MILLIS is waited out
+after the release as well.
+******************************************************************************/
+
+void CalibrationWaitForRelease(void)
+{
+    while(digitalRead(MODE_SWITCH) == 0 && CalibrationTimedOut() == false)
+    {
+        /* Do Nothing */
+    }
+
+    delay(BUTTON_DEBOUNCE_MILLIS);
+}
+
+
+
+/******************************************************************************
+ ResetCalibration - Reinitialise flags to enable another calibration attempt.
+
+Modify flags and timers.
+Increased delay before starting Low calibration routine to enable time to
+power cycle TX gear.
+Flash some LEDs to indicate Recalibration has begun.
+******************************************************************************/
+
+
+void ResetCalibration(void)    /* This works fine. (with old calibration routine.) */
+{
+    // DROP INTO THIS LOOP TO RESET FLAGS AND TIMERS.
+
+    digitalWrite(LED_025_P, LOW);
+    digitalWrite(LED_050_P, LOW);
+    digitalWrite(LED_075_P, LOW);
+    digitalWrite(LED_100_P, LOW);
+
+    if(DebugMode == true)
+    {
+        Serial.print(F("Resetting flags...."));
+    }
+
+    /* Reset flags to default values, enable another calibration cycle. */
+    AutoRSSIMode = true;
+    MinRSSICalibrationFlag = false;
+    MaxRSSICalibrationFlag = false;
+    MinCalibRunOnce = false;
+    MaxCalibRunOnce =false;
+    RSSICalibrationCompleteFlag = false;
+    //OneTimeWarmupDelayFlag = true;
+
+    StartMinCal = false;
+    MinCalibrateButtonCheck = true;
+
+    StartMaxCal = false;
+    MaxCalibrateButtonCheck = true;
+
+    RecalibrateButtonCheck = true;  /* Allow us to listen out for another recalibration attempt. */
+    CalibrationTimeoutCounter = millis();   /* Give the new attempt the full time-out. */
+    //CalibRetryDelayFlag = true;     /* add X second delay at the start of the next calibration attempt. */
+    Recalibrate = false;    /* Next time through the loop, we wont be coming back here unless button is pressed again. */
+
+    if(DebugMode == true)
+    {
+        Serial.println(F("Done!"));
+    }
+
+    //RecalibrationOffsetCounter = (CalibrationTimeoutCounter + CALIB_RETRY_INITIAL_DELAY);  /* add X seconds of time (since power up) to the timeout counter. */
+
+    if(DebugMode == true)
+    {
+    //  Serial.println(F("Time-out counter has been modified..."));
+        Serial.println(F("Restarting Calibration..."));
+    }
+
+    digitalWrite(LED_025_P, HIGH);            /* flash some LEDs. */
+    digitalWrite(LED_050_P, HIGH);
+    digitalWrite(LED_075_P, HIGH);
+    digitalWrite(LED_100_P, HIGH);
+    delay(100);
+    digitalWrite(LED_025_P, LOW);
+    digitalWrite(LED_050_P, LOW);
+    digitalWrite(LED_075_P, LOW);
+    digitalWrite(LED_100_P, LOW);
+    delay(100);
+    digitalWrite(LED_025_P, HIGH);            /* flash some LEDs. */
+    digitalWrite(LED_050_P, HIGH);
+    digitalWrite(LED_075_P, HIGH);
+    digitalWrite(LED_100_P, HIGH);
+    delay(100);
+    digitalWrite(LED_025_P, LOW);
+    digitalWrite(LED_050_P, LOW);
+    digitalWrite(LED_075_P, LOW);
+    digitalWrite(LED_100_P, LOW);
+    delay(100);
+    digitalWrite(LED_025_P, HIGH);            /* flash some LEDs. */
+    digitalWrite(LED_050_P, HIGH);
+    digitalWrite(LED_075_P, HIGH);
+    digitalWrite(LED_100_P, HIGH);
+    delay(100);
+    digitalWrite(LED_025_P, LOW);
+    digitalWrite(LED_050_P, LOW);
+    digitalWrite(LED_075_P, LOW);
+    digitalWrite(LED_100_P, LOW);
+    delay(100);
+    digitalWrite(LED_025_P, HIGH);            /* flash some LEDs. */
+    digitalWrite(LED_050_P, HIGH);
+    digitalWrite(LED_075_P, HIGH);
+    digitalWrite(LED_100_P, HIGH);
+    delay(100);
+    digitalWrite(LED_025_P, LOW);
+    digitalWrite(LED_050_P, LOW);
+    digitalWrite(LED_075_P, LOW);
+    digitalWrite(LED_100_P, LOW);
+    delay(100);
+
+
+}    /* Back to beginning of main loop, followed by calibration. */
+
+
+
+/******************************************************************************
+ RSSI TRACE FORMAT
+
+A trace is a header followed by any number of blocks. Multi-byte values are
+little endian, as they sit in ATmega328 memory.
+
+Header, TRACE_HEADER_BYTES:
+  0   4   "D4RT"
+  4   1   Format version, TRACE_VERSION.
+  5   1   Header size in bytes, readers skip anything past what they know.
+  6   2   Sample interval, milliseconds.
+  8   2   RSSI1Min      (ADC steps)
+  10  2   RSSI1Max      (ADC steps)
+  12  2   RSSI2Min      (ADC steps)
+  14  2   RSSI2Max      (ADC steps)
+  16  2   RSSIARef      (millivolts)
+
+Block, TRACE_BLOCK_HEADER_BYTES + 2 x (samples - 1) + 1 bytes:
+  0   1   TRACE_SYNC
+  1   1   Number of samples in the block, 1 to TRACE_BLOCK_SAMPLES.
+  2   2   Block sequence number, counts up from 0 at the header.
+  4   2   First sample: RX1 ADC reading, bits 0-9. Bit 15 set if RX2 was
+          the selected receiver at this sample.
+  6   2   ...      as above for RX2, bit 15 unused.
+  8   2n  One signed byte RX1 delta and one signed byte RX2 delta for each
+          following sample, taken from the previous sample.
+  end 1   Sum of all previous bytes of the block, modulo 256.
+
+Samples are one sample interval apart. If the loop stalls for longer than
+that, the samples it missed are dropped rather than sent late, back to back
+with readings taken after the stall.
+
+Each block starts with absolute readings so it can be decoded on its own.
+A recorder can index the file by block sequence number and seek straight to
+any point; a gap in the sequence means a block was lost. A block is closed
+early when a delta won't fit in a signed byte. tools/trace reads, indexes and
+converts traces on a PC.
+******************************************************************************/
+
+
+
+/******************************************************************************
+ TraceStart - Start sending a binary RSSI trace.
+******************************************************************************/
+
+void TraceStart(void)
+{
+    byte Header[TRACE_HEADER_BYTES] = { 'D', '4', 'R', 'T', TRACE_VERSION, TRACE_HEADER_BYTES };
+    unsigned int Fields[6] = { TRACE_INTERVAL_MILLIS, RSSI1Min, RSSI1Max, RSSI2Min, RSSI2Max, (unsigned int)(RSSIARef * 1000 + 0.5) };
+
+    for(int Field = 0; Field < 6; Field++)
+    {
+        Header[6 + (2 * Field)] = lowByte(Fields[Field]);
+        Header[7 + (2 * Field)] = highByte(Fields[Field]);
+    }
+
+    Serial.println(F(" "));
+    Serial.flush();                 /* Any debug text goes out before the trace. */
+    Serial.write(Header, TRACE_HEADER_BYTES);
+
+    TraceMode = true;
+    TraceSequence = 0;
+    TraceBlockSamples = 0;
+    TracePreviousTime = millis();
+}
+
+
+
+/******************************************************************************
+ TraceStop - Send any part built block and go back to debug text.
+******************************************************************************/
+
+void TraceStop(void)
+{
+    TraceFlush();
+    TraceMode = false;
+}
+
+
+
+/******************************************************************************
+ TraceSample - Add one pair of RSSI readings to the trace.
+******************************************************************************/
+
+void TraceSample(unsigned int Sample1, unsigned int Sample2)
+{
+    int Delta1 = Sample1 - TracePrevious1;
+    int Delta2 = Sample2 - TracePrevious2;
+
+    if(TraceBlockSamples > 0 && (Delta1 > 127 || Delta1 < -128 || Delta2 > 127 || Delta2 < -128))
+    {
+        TraceFlush();       /* Won't fit as a delta, start a new block. */
+    }
+
+    if(TraceBlockSamples == 0)
+    {
+        Sample1 |= (RxControlPinState == HIGH) ? 0x8000 : 0;
+        TraceBlock[0] = TRACE_SYNC;
+        TraceBlock[2] = lowByte(TraceSequence);
+        TraceBlock[3] = highByte(TraceSequence);
+        TraceBlock[4] = lowByte(Sample1);
+        TraceBlock[5] = highByte(Sample1);
+        TraceBlock[6] = lowByte(Sample2);
+        TraceBlock[7] = highByte(Sample2);
+        Sample1 &= 0x3FF;
+    }
+
+    else
+    {
+        TraceBlock[TRACE_BLOCK_HEADER_BYTES + (2 * (TraceBlockSamples - 1))] = (byte)Delta1;
+        TraceBlock[TRACE_BLOCK_HEADER_BYTES + (2 * (TraceBlockSamples - 1)) + 1] = (byte)Delta2;
+    }
+
+    TracePrevious1 = Sample1;
+    TracePrevious2 = Sample2;
+    TraceBlockSamples++;
+
+    if(TraceBlockSamples >= TRACE_BLOCK_SAMPLES)
+    {
+        TraceFlush();
+    }
+}
+
+
+
+/******************************************************************************
+ TraceFlush - Finish the trace block being built and send it.
+******************************************************************************/
+
+void TraceFlush(void)
+{
+    int Length = TRACE_BLOCK_HEADER_BYTES + (2 * (TraceBlockSamples - 1));
+    byte Checksum = 0;
+
+    if(TraceBlockSamples == 0)
+    {
+        return;
+    }
+
+    TraceBlock[1] = TraceBlockSamples;
+
+    for(int Byte = 0; Byte < Length; Byte++)
+    {
+        Checksum += TraceBlock[Byte];
+    }
+
+    TraceBlock[Length] = Checksum;
+    Serial.write(TraceBlock, Length + 1);
+
+    TraceSequence++;
+    TraceBlockSamples = 0;
+}
+
+
+
+/******************************************************************************
+ BandgapStart - Begin a check of the ADC reference. (see BandgapUpdate)
+******************************************************************************/
+
+void BandgapStart(void)
+{
+    BandgapPreviousTime = millis();
+
+    if(RSSI_ADC_REFERENCE != EXTERNAL)
+    {
+        BandgapState = BANDGAP_READING;
+        BandgapSum = 0;
+        BandgapCount = 0;
+    }
+}
+
+
+
+/******************************************************************************
+ BandgapUpdate - Compensate the RSSI limits for drift of the ADC reference.
+
+The ATmega328 1V1 bandgap varies from about 1.0V to 1.2V between parts and
+moves with temperature, the supply moves with load. Either changes every ADC
+reading of the same RSSI voltage, so calibrated limits slowly go stale.
+
+The bandgap is read against the supply (AVcc), which gives the ratio of the
+two. With the INTERNAL reference the supply is taken as the steady one and
+readings scale with 1 / bandgap. With DEFAULT the bandgap is taken as the
+steady one and readings scale with 1 / supply. EXTERNAL reference ICs are
+better than either, so nothing is done.
+
+Rather than correct every reading, the RSSI limits are rescaled from the
+figures they had when the first check (or calibration) was taken, so the RSSI
+path costs nothing extra.
+
+Each call is one step of the check started by BandgapStart(), so no loop pass
+is held up for long: BANDGAP_PASS_READINGS readings of the bandgap a pass
+until there are BANDGAP_READINGS, then, with INTERNAL, BANDGAP_SETTLE_MILLIS
+for the AREF capacitor to come back down from AVcc to 1V1. With INTERNAL RSSI
+can't be read until then, so the loop keeps its last RSSI figures. (see
+BandgapHolding) With DEFAULT both share AVcc and RSSI is read between steps.
+******************************************************************************/
+
+void BandgapUpdate(void)
+{
+    if(BandgapState == BANDGAP_READING)
+    {
+        BandgapRead();
+
+        if(BandgapCount >= BANDGAP_READINGS)
+        {
+            BandgapSettleTime = millis();
+            BandgapState = BANDGAP_SETTLING;
+        }
+
+        if(RSSI_ADC_REFERENCE == DEFAULT)
+        {
+            analogRead(RSSI1_ADC_PIN);      /* Leave the ADC on RSSI1 for paired sampling. */
+        }
+
+        else if(BandgapState == BANDGAP_SETTLING)
+        {
+            ADMUX = (RSSI_ADC_REFERENCE << REFS0) | (RSSI1_ADC_PIN - A0);  /* As analogRead() would, without converting before AREF settles. */
+        }
+
+        else
+        {
+            /* Do Nothing, stay on the bandgap until the readings are done. */
+        }
+    }
+
+    else if(BandgapState == BANDGAP_SETTLING &&
+        (RSSI_ADC_REFERENCE != INTERNAL || (millis() - BandgapSettleTime) > BANDGAP_SETTLE_MILLIS))
+    {
+        BandgapState = BANDGAP_IDLE;
+        BandgapApply(BandgapSum);
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+}
+
+
+
+/******************************************************************************
+ BandgapHolding - True whilst a bandgap check has the ADC off the RSSI reference.
+******************************************************************************/
+
+boolean BandgapHolding(void)
+{
+    return (RSSI_ADC_REFERENCE == INTERNAL && BandgapState != BANDGAP_IDLE && InjectMode == false);
+}
+
+
+
+/******************************************************************************
+ BandgapApply - Rescale the RSSI limits from a finished bandgap check.
+******************************************************************************/
+
+void BandgapApply(unsigned int Bandgap)
+{
+    if(BandgapBase == 0)
+    {
+        BandgapBase = Bandgap;
+        RSSI1MinBase = RSSI1Min;
+        RSSI1MaxBase = RSSI1Max;
+        RSSI2MinBase = RSSI2Min;
+        RSSI2MaxBase = RSSI2Max;
+    }
+
+    if(RSSI_ADC_REFERENCE == INTERNAL)
+    {
+        RSSIARef = SUPPLY_NOMINAL_VOLTS * Bandgap / (ADC_MAX * BANDGAP_READINGS);
+        RSSI1Min = (unsigned long)RSSI1MinBase * BandgapBase / Bandgap;
+        RSSI1Max = (unsigned long)RSSI1MaxBase * BandgapBase / Bandgap;
+        RSSI2Min = (unsigned long)RSSI2MinBase * BandgapBase / Bandgap;
+        RSSI2Max = (unsigned long)RSSI2MaxBase * BandgapBase / Bandgap;
+    }
+
+    else
+    {
+        RSSIARef = BANDGAP_NOMINAL_VOLTS * ADC_MAX * BANDGAP_READINGS / Bandgap;
+        RSSI1Min = (unsigned long)RSSI1MinBase * Bandgap / BandgapBase;
+        RSSI1Max = (unsigned long)RSSI1MaxBase * Bandgap / BandgapBase;
+        RSSI2Min = (unsigned long)RSSI2MinBase * Bandgap / BandgapBase;
+        RSSI2Max = (unsigned long)RSSI2MaxBase * Bandgap / BandgapBase;
+    }
+}
+
+
+
+/******************************************************************************
+ BandgapRead - Add up to BANDGAP_PASS_READINGS bandgap readings to BandgapSum.
+
+The bandgap is read against AVcc. analogRead() can't select it, so the ADC is
+driven directly. When the ADC wasn't already on it, the first readings after
+switching are thrown away whilst the bandgap settles.
+******************************************************************************/
+
+void BandgapRead(void)
+{
+    byte Bandgap = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);    /* AVcc reference, bandgap input. */
+    int Discard = 0;
+
+    if(ADMUX != Bandgap)
+    {
+        ADMUX = Bandgap;
+        delayMicroseconds(250);
+        Discard = 4;
+    }
+
+    for(int Reading = 0; Reading < Discard + BANDGAP_PASS_READINGS && BandgapCount < BANDGAP_READINGS; Reading++)
+    {
+        ADCSRA |= _BV(ADSC);
+
+        while(ADCSRA & _BV(ADSC))
+        {
+            /* Wait for the conversion. */
+        }
+
+        if(Reading >= Discard)
+        {
+            BandgapSum += ADC;
+            BandgapCount++;
+        }
+    }
+}
+
+
+
+/******************************************************************************
+ RSSIAverageFill - Fill the RSSI averages with a burst of real readings.
+
+So the first passes through the loop see a true RSSI. Called from setup(),
+or, with INTERNAL, from the first loop pass after the boot bandgap check has
+let AREF settle.
+******************************************************************************/
+
+void RSSIAverageFill(void)
+{
+    /* Warm up ADCs, finishing on RSSI1 where paired sampling starts. */
+    for(int Warmup = 0; Warmup < ADC_WARMUP_READS; Warmup++)
+    {
+        RSSI2InputPinValue = analogRead(RSSI2_ADC_PIN);
+        RSSI1InputPinValue = analogRead(RSSI1_ADC_PIN);
+    }
+
+    RSSI1Total = 0;
+    RSSI2Total = 0;
+
+    for(int ReadingCurrent = 0; ReadingCurrent < MAX_AVERAGE_READINGS; ReadingCurrent++)
+    {
+        RSSIPairRead();
+        RSSI1Readings[ReadingCurrent] = RSSI1InputPinValue;
+        RSSI1Total = RSSI1Total + RSSI1Readings[ReadingCurrent];
+        RSSI2Readings[ReadingCurrent] = RSSI2InputPinValue;
+        RSSI2Total = RSSI2Total + RSSI2Readings[ReadingCurrent];
+    }
+
+    RSSI1Average = RSSI1Total / MAX_AVERAGE_READINGS;
+    RSSI2Average = RSSI2Total / MAX_AVERAGE_READINGS;
+    RSSI1PPrevious = constrain(map(RSSI1Average, RSSI1Min, RSSI1Max, 0, 100), 0, 100);    /* Don't let the noise estimate see a jump from zero. */
+    RSSI2PPrevious = constrain(map(RSSI2Average, RSSI2Min, RSSI2Max, 0, 100), 0, 100);
+    HealthPrevious[0] = RSSI1Readings[MAX_AVERAGE_READINGS - 1];             /* Nor the health check. */
+    HealthPrevious[1] = RSSI2Readings[MAX_AVERAGE_READINGS - 1];
+    RSSIAverageFilled = true;
+}
+
+
+
+/******************************************************************************
+ TrackerSetup - Start servo frames for the antenna tracker on TRACKER_SERVO_PIN.
+
+Timer1 is put in fast PWM with ICR1 as TOP, clock / 8 gives 0.5us per count
+and 40000 counts a 20ms frame. OC1B makes the pulse, so its length is exact
+and costs nothing in the loop. This takes Timer1 away from analogWrite() on
+D9 and D10.
+******************************************************************************/
+
+void TrackerSetup(void)
+{
+    pinMode(TRACKER_SERVO_PIN, OUTPUT);
+
+    TCCR1A = _BV(COM1B1) | _BV(WGM11);                  /* OC1B non-inverting, fast PWM, TOP = ICR1. */
+    TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11);       /* Clock / 8. */
+    ICR1 = 39999;                                       /* 20ms frame. */
+    OCR1B = TrackerPosition * 2;
+}
+
+
+
+/******************************************************************************
+ TrackerUpdate - One step of the antenna tracker control loop.
+
+The patch RSSI less the omni RSSI cancels out changes in the link itself,
+leaving how well the patch is pointed. That figure peaks on target, it doesn't
+say which way to turn, so the servo is rocked TRACKER_DITHER either side of
+its aim. The difference on the high side less the low side is the slope, it is
+zero on target and its sign says which way the target lies. A PI controller
+drives the slope to zero, the integral term is the aim.
+
+The servo never moves more than TRACKER_SLEW per update. Readings are skipped
+whilst it is held back by that, and for TRACKER_SETTLE_UPDATES after, so the
+servo and the RSSI averages have caught up before a side is measured.
+
+If the patch stays TRACKER_LOSS_LEVEL below the omni for TRACKER_LOSS_MILLIS,
+the target is lost and the servo sweeps end to end until the patch comes back
+up to TRACKER_ACQUIRE_LEVEL, the aim restarts from there.
+
+The tracker holds still in spectrum analyser mode and whilst either receiver
+is faulty, its RSSI means nothing for pointing.
+******************************************************************************/
+
+void TrackerUpdate(void)
+{
+    long Level1 = constrain(map(RSSI1Average, RSSI1Min, RSSI1Max, 0, 1000), 0, 1000);
+    long Level2 = constrain(map(RSSI2Average, RSSI2Min, RSSI2Max, 0, 1000), 0, 1000);
+    int Target;
+
+    TrackerDifference = (TRACKER_PATCH_RX == 0) ? (Level1 - Level2) : (Level2 - Level1);
+
+    if(VideoSwitchCounter == 2 || HealthFault[0] != HEALTH_OK || HealthFault[1] != HEALTH_OK)
+    {
+        TrackerLossTime = millis();     /* Hold, and don't count the time as lost. */
+        return;
+    }
+
+    if(TrackerScanning == true)
+    {
+        if(TrackerDifference >= TRACKER_ACQUIRE_LEVEL)
+        {
+            TrackerScanning = false;        /* Found, aim from here. */
+            TrackerAim = TrackerPosition;
+            TrackerSlope = 0;
+            TrackerDitherSide = 0;
+            TrackerDitherCount = 0;
+            TrackerDitherTotal[0] = 0;
+            TrackerDitherTotal[1] = 0;
+            TrackerLossTime = millis();
+        }
+
+        else if(TrackerPosition >= TRACKER_SERVO_MAX)
+        {
+            TrackerScanDirection = -1;
+        }
+
+        else if(TrackerPosition <= TRACKER_SERVO_MIN)
+        {
+            TrackerScanDirection = 1;
+        }
+
+        else
+        {
+            /* Do Nothing */
+        }
+    }
+
+    else if(TrackerDifference >= TRACKER_LOSS_LEVEL)
+    {
+        TrackerLossTime = millis();
+    }
+
+    else if((millis() - TrackerLossTime) > TRACKER_LOSS_MILLIS)
+    {
+        TrackerScanning = true;         /* Lost, start sweeping from where we are. */
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(TrackerScanning == true)
+    {
+        Target = TrackerPosition + (TrackerScanDirection * TRACKER_SCAN_STEP);
+    }
+
+    else
+    {
+        if(TrackerMoving == false)
+        {
+            TrackerDitherCount++;       /* Only time spent in place counts. */
+        }
+
+        if(TrackerDitherCount > TRACKER_SETTLE_UPDATES)
+        {
+            TrackerDitherTotal[TrackerDitherSide] += TrackerDifference;
+        }
+
+        if(TrackerDitherCount >= TRACKER_DITHER_UPDATES)
+        {
+            if(TrackerDitherSide == 1)      /* Both sides done, take the slope. */
+            {
+                TrackerSlope = (float)(TrackerDitherTotal[1] - TrackerDitherTotal[0]) / (TRACKER_DITHER_UPDATES - TRACKER_SETTLE_UPDATES);
+                TrackerAim = constrain(TrackerAim + (TRACKER_KI * TrackerSlope), TRACKER_SERVO_MIN + TRACKER_DITHER, TRACKER_SERVO_MAX - TRACKER_DITHER);
+                TrackerDitherTotal[0] = 0;
+                TrackerDitherTotal[1] = 0;
+            }
+
+            TrackerDitherSide = 1 - TrackerDitherSide;
+            TrackerDitherCount = 0;
+        }
+
+        Target = TrackerAim + (TRACKER_KP * TrackerSlope) + ((TrackerDitherSide == 1) ? TRACKER_DITHER : -TRACKER_DITHER);
+    }
+
+    Target = constrain(Target, TRACKER_SERVO_MIN, TRACKER_SERVO_MAX);
+    TrackerPosition += constrain(Target - TrackerPosition, -TRACKER_SLEW, TRACKER_SLEW);
+    TrackerMoving = (TrackerPosition != Target);
+
+    OCR1B = TrackerPosition * 2;        /* Takes effect at the start of the next frame. */
+}
+
+
+
+/******************************************************************************
+ HealthCheck - Look for a dead or disconnected receiver in its ADC readings.
+
+A receiver is faulty if its RSSI is:
+  HEALTH_RAIL   pinned near 0V, the receiver has browned out or lost power.
+  HEALTH_STUCK  exactly the same for HEALTH_STUCK_SAMPLES readings, a live
+                RSSI always has some ADC noise on it. Readings from
+                HEALTH_FULL_SCALE up don't count, strong signals can sit above
+                the 1V1 reference.
+  HEALTH_FLOATING  dragged down by HEALTH_PROBE_LIMIT or more when 0V is
+                converted just before it, HEALTH_PROBE_FAILS times in a row.
+                The RSSI wire is off and the input only holds the charge the
+                ADC leaves on it. (see HealthProbe)
+How much a reading moves from pass to pass is no guide, fast multipath fading
+moves a healthy RSSI about as much as hum on a floating input.
+
+A fault is flagged on the reading that shows it, recovery needs the receiver
+to look healthy for HEALTH_RECOVERY_MILLIS.
+******************************************************************************/
+
+void HealthCheck(int Rx, unsigned int Sample)
+{
+    int Change = Sample - HealthPrevious[Rx];
+    byte Fault = HEALTH_OK;
+
+    if(Change == 0 && Sample < HEALTH_FULL_SCALE)
+    {
+        if(HealthStuckCount[Rx] < HEALTH_STUCK_SAMPLES)
+        {
+            HealthStuckCount[Rx]++;
+        }
+    }
+
+    else
+    {
+        HealthStuckCount[Rx] = 0;
+    }
+
+    HealthPrevious[Rx] = Sample;
+
+    if((millis() - HealthProbeTime[Rx]) >= HEALTH_PROBE_MILLIS && InjectMode == false)
+    {
+        HealthProbeTime[Rx] = millis();
+
+        if((int)(Sample - HealthProbe((Rx == 0) ? RSSI1_ADC_PIN : RSSI2_ADC_PIN)) >= HEALTH_PROBE_LIMIT)
+        {
+            if(HealthProbeFails[Rx] < HEALTH_PROBE_FAILS)
+            {
+                HealthProbeFails[Rx]++;
+            }
+        }
+
+        else
+        {
+            HealthProbeFails[Rx] = 0;
+        }
+    }
+
+    if(Sample < HEALTH_RAIL_LOW)
+    {
+        Fault = HEALTH_RAIL;
+    }
+
+    else if(HealthStuckCount[Rx] >= HEALTH_STUCK_SAMPLES)
+    {
+        Fault = HEALTH_STUCK;
+    }
+
+    else if(HealthProbeFails[Rx] >= HEALTH_PROBE_FAILS)
+    {
+        Fault = HEALTH_FLOATING;
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(Fault != HEALTH_OK)
+    {
+        if(FEATURE_SERIAL == true && DebugMode == true && TraceMode == false && HealthFault[Rx] == HEALTH_OK)
+        {
+            Serial.println(F("  "));
+            Serial.print(F("RX"));
+            Serial.print(Rx + 1);
+            Serial.print(F(" FAULT "));
+            Serial.println(Fault);
+        }
+
+        HealthFault[Rx] = Fault;
+        HealthFaultTime[Rx] = millis();
+    }
+
+    else if(HealthFault[Rx] != HEALTH_OK && (millis() - HealthFaultTime[Rx]) > HEALTH_RECOVERY_MILLIS)
+    {
+        HealthFault[Rx] = HEALTH_OK;
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+}
+
+
+
+/******************************************************************************
+ HealthProbe - Read an RSSI pin straight after converting 0V.
+
+The ADC sample capacitor is left at 0V by a conversion of the internal ground
+channel, then the pin is read as RSSIPairRead() would, one settling reading
+and one kept. A driven RSSI charges the capacitor back and reads as usual. A
+floating input has nothing to charge it with, so it reads well below where it
+was, whereas in RSSIPairRead() it reads close to the other receiver. The ADC
+is left on RSSI1 for paired sampling.
+******************************************************************************/
+
+unsigned int HealthProbe(int Pin)
+{
+    unsigned int Reading = 0;
+
+    ADMUX = (ADMUX & 0xF0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1) | _BV(MUX0);   /* Same reference, 0V input. */
+
+    for(int Conversion = 0; Conversion < 3; Conversion++)
+    {
+        ADCSRA |= _BV(ADSC);
+
+        while(ADCSRA & _BV(ADSC))
+        {
+            /* Wait for the conversion. */
+        }
+
+        Reading = ADC;
+        ADMUX = (ADMUX & 0xF0) | ((Pin - A0) & 0x0F);
+    }
+
+    analogRead(RSSI1_ADC_PIN);      /* Leave the ADC on RSSI1 for paired sampling. */
+
+    return Reading;
+}
+
+
+
+/******************************************************************************
+ HealthLED - State for a receiver LED, blinking out any fault.
+
+A faulty receiver's LED blinks once for HEALTH_STUCK, twice for HEALTH_RAIL
+and three times for HEALTH_FLOATING, every HEALTH_BLINK_PERIOD_MILLIS.
+******************************************************************************/
+
+boolean HealthLED(int Rx, boolean Selected)
+{
+    unsigned int Blink = (millis() % HEALTH_BLINK_PERIOD_MILLIS) / HEALTH_BLINK_MILLIS;
+
+    if(HealthFault[Rx] == HEALTH_OK)
+    {
+        return Selected;
+    }
+
+    return (Blink < (2 * HealthFault[Rx]) && (Blink % 2) == 0);
+}
+
+
+
+/******************************************************************************
+ DIVERSITY DECISION TRACE FORMAT
+
+In serial debug mode every diversity evaluation is classified by the rule that
+decided it. A record is written whenever the rule, the selected receiver or
+the order of the raw (unaveraged) RSSI changes, so the ring covers seconds of
+activity rather than milliseconds. Send DECISION_SERIAL_DUMP to get the ring,
+oldest record first. When a switch comes more than DECISION_SLOW_MILLIS after
+the raw RSSI crossed over, recording stops so the run-up to that switch is
+kept until the next dump.
+
+The debug text line takes ~88ms a pass at 19200 baud, which would swamp the
+latencies being measured. Send DECISION_SERIAL_QUIET first to stop it, the
+loop then runs at full speed, and again after the dump to bring it back.
+tools/trace/DecisionLatency splits each switch in a captured dump.
+
+Multi-byte values are little endian.
+
+Dump header, DECISION_HEADER_BYTES:
+  0   4   "D4RD"
+  4   1   Format version, DECISION_VERSION.
+  5   1   Record size in bytes, DECISION_RECORD_BYTES.
+  6   1   Number of records that follow.
+  7   1   1 if recording was held by a slow switch.
+
+Record, DECISION_RECORD_BYTES:
+  0   2   millis(), low 16 bits.
+  2   1   RSSI1P, averaged and calibrated %.
+  3   1   RSSI2P
+  4   1   RX1 latest raw reading as a calibrated %.
+  5   1   RX2 ...
+  6   2   Time since the last switch, milliseconds, 65535 max.
+  8   2   DiversityIntervalMillis in use.
+  10  1   DiversityHysteresis in use, %.
+  11  1   Bits 0-3 the rule, DECISION_HOLD_BETTER to DECISION_HOLD_FROZEN.
+          Bits 4-6 the policy in use, POLICY_LEVEL to POLICY_FREEZE.
+          Bit 7 set if RX2 is selected after the evaluation.
+
+The rules compare receiver scores, which under POLICY_SCORED are not the
+percentages recorded.
+
+  end 1   Sum of all previous bytes of the dump, modulo 256.
+
+A late switch splits into three parts. Filter delay runs from the raw RSSI
+crossing over to the averages doing so (end of HOLD_BETTER). Hysteresis delay
+is the time spent in HOLD_HYSTERESIS. Dwell is the time spent in HOLD_DWELL
+before the SWITCH.
+******************************************************************************/
+
+
+
+/******************************************************************************
+ DecisionRecord - Classify one diversity evaluation, and record it if anything
+ has changed.
+
+Called after the mode 3 logic with the receiver selected before it ran. The
+rules are worked out from the same inputs the logic used, a switch is seen as
+a change of receiver.
+******************************************************************************/
+
+void DecisionRecord(int PreviousRxState, unsigned long Elapsed)
+{
+    int Raw1 = constrain(map(LatestReading(RSSI1Readings, RSSI1ReadIndex), RSSI1Min, RSSI1Max, 0, 100), 0, 100);
+    int Raw2 = constrain(map(LatestReading(RSSI2Readings, RSSI2ReadIndex), RSSI2Min, RSSI2Max, 0, 100), 0, 100);
+    boolean RawOtherBetter = (PreviousRxState == LOW) ? (Raw2 > Raw1) : (Raw1 > Raw2);
+    int Selected = (PreviousRxState == LOW) ? DiversityScore[0] : DiversityScore[1];
+    int Other = (PreviousRxState == LOW) ? DiversityScore[1] : DiversityScore[0];
+    byte Rule;
+    byte Key;
+    byte *Record;
+
+    if((HealthFault[0] != HEALTH_OK) != (HealthFault[1] != HEALTH_OK))
+    {
+        Rule = DECISION_QUARANTINE;
+    }
+
+    else if(RxControlPinState != PreviousRxState)
+    {
+        Rule = DECISION_SWITCH;
+    }
+
+    else if(DiversityPolicyActive == POLICY_FREEZE)
+    {
+        Rule = DECISION_HOLD_FROZEN;
+    }
+
+    else if(Other <= Selected)
+    {
+        Rule = DECISION_HOLD_BETTER;
+    }
+
+    else if(Other <= Selected + DiversityHysteresis)
+    {
+        Rule = DECISION_HOLD_HYSTERESIS;
+    }
+
+    else
+    {
+        Rule = DECISION_HOLD_DWELL;
+    }
+
+    if(Rule == DECISION_SWITCH && DecisionHeld == false && (millis() - DecisionCrossTime) > DECISION_SLOW_MILLIS)
+    {
+        DecisionPreviousKey = 0xFF;     /* Always record the slow switch itself, then stop. */
+        DecisionHeld = true;
+    }
+
+    else if(DecisionHeld == true)
+    {
+        return;
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(RawOtherBetter == false || Rule == DECISION_SWITCH)
+    {
+        DecisionCrossTime = millis();   /* Latency runs from when the raw RSSI last crossed over. */
+    }
+
+    Key = Rule | (RxControlPinState << 3) | (RawOtherBetter << 4) | (DiversityPolicyActive << 5);
+
+    if(Key == DecisionPreviousKey)
+    {
+        return;
+    }
+
+    DecisionPreviousKey = Key;
+
+    if(Elapsed > 65535)
+    {
+        Elapsed = 65535;
+    }
+
+    Record = DecisionRing[DecisionHead];
+    Record[0] = lowByte(millis());
+    Record[1] = highByte(millis());
+    Record[2] = RSSI1P;
+    Record[3] = RSSI2P;
+    Record[4] = Raw1;
+    Record[5] = Raw2;
+    Record[6] = lowByte(Elapsed);
+    Record[7] = highByte(Elapsed);
+    Record[8] = lowByte(DiversityIntervalMillis);
+    Record[9] = highByte(DiversityIntervalMillis);
+    Record[10] = DiversityHysteresis;
+    Record[11] = Rule | (DiversityPolicyActive << 4) | (RxControlPinState == HIGH ? 0x80 : 0);
+
+    DecisionHead = (DecisionHead + 1) % DECISION_RECORDS;
+
+    if(DecisionCount < DECISION_RECORDS)
+    {
+        DecisionCount++;
+    }
+}
+
+
+
+/******************************************************************************
+ DecisionDump - Send the decision trace, oldest record first, and start again.
+******************************************************************************/
+
+void DecisionDump(void)
+{
+    byte Header[DECISION_HEADER_BYTES] = { 'D', '4', 'R', 'D', DECISION_VERSION, DECISION_RECORD_BYTES, DecisionCount, DecisionHeld };
+    byte Checksum = 0;
+    byte Index = (DecisionHead + DECISION_RECORDS - DecisionCount) % DECISION_RECORDS;
+
+    for(int Byte = 0; Byte < DECISION_HEADER_BYTES; Byte++)
+    {
+        Checksum += Header[Byte];
+    }
+
+    Serial.write(Header, DECISION_HEADER_BYTES);
+
+    for(int Count = 0; Count < DecisionCount; Count++)
+    {
+        for(int Byte = 0; Byte < DECISION_RECORD_BYTES; Byte++)
+        {
+            Checksum += DecisionRing[Index][Byte];
+        }
+
+        Serial.write(DecisionRing[Index], DECISION_RECORD_BYTES);
+        Index = (Index + 1) % DECISION_RECORDS;
+    }
+
+    Serial.write(Checksum);
+
+    DecisionCount = 0;
+    DecisionPreviousKey = 0xFF;
+    DecisionHeld = false;
+}
+
+
+
+/******************************************************************************
+ TRACE INJECTION
+
+For bench testing, RSSI readings can be streamed in over the serial port and
+used in place of the ADC. Only the serial port is used so this works the same
+on the real board and in a simulator with a virtual UART.
+
+PROFILE_BENCH only, other builds never open the serial port unless the mode
+button is held for debug mode. Don't hold either button at power up. Within
+INJECT_LISTEN_MILLIS of the end of setup() the host sends "D4RI" at
+INJECT_BAUD, the unit answers "D4RI" and from then on takes one pair of
+readings per pass through the loop from trace blocks sent by the host, in the
+RSSI TRACE FORMAT above. The header is not sent. The loop waits for samples,
+so it runs at whatever rate the host feeds it. If none come for
+INJECT_TIMEOUT_MILLIS, the host is taken to be gone and the receivers are read
+again until the next power up. tools/host/InjectReplay plays a trace in and
+diffs the switches sent back against the same trace read through the ADC.
+
+Two blocks are buffered. One is used whilst the next is received, so the host
+should keep two blocks in flight and send another on each INJECT_ACK.
+  INJECT_ACK     1 byte, then the 2 byte sequence number of the used up block.
+  INJECT_NAK     1 byte, then the 2 byte sequence number of a block that failed
+                 its checksum and was thrown away.
+  INJECT_SWITCH  1 byte, then the 4 byte number of injected samples used before
+                 the switch, 4 byte millis() and 1 byte new RxControlPinState.
+******************************************************************************/
+
+
+
+/******************************************************************************
+ InjectStart - Listen for a host asking for trace injection after power up.
+******************************************************************************/
+
+void InjectStart(void)
+{
+    const char Magic[] = "D4RI";
+
+    while(Serial.available() > 0)
+    {
+        if(Serial.read() == Magic[InjectMagicMatched])
+        {
+            InjectMagicMatched++;
+        }
+
+        else
+        {
+            InjectMagicMatched = 0;
+        }
+
+        if(InjectMagicMatched == 4)
+        {
+            Serial.write((const byte *)Magic, 4);
+            InjectMode = true;
+            InjectListen = false;
+            return;
+        }
+    }
+
+    if((millis() - InjectListenStartTime) > INJECT_LISTEN_MILLIS)
+    {
+        Serial.end();           /* Nobody asked, put the serial port away. */
+        InjectListen = false;
+    }
+}
+
+
+
+/******************************************************************************
+ InjectReceive - Take bytes from the serial port into the free block buffer.
+******************************************************************************/
+
+void InjectReceive(void)
+{
+    byte *Block = InjectBlock[InjectFilling];
+
+    while(InjectReady[InjectFilling] == false && Serial.available() > 0)
+    {
+        byte Received = Serial.read();
+        int Length;
+
+        if(InjectFill == 0 && Received != TRACE_SYNC)
+        {
+            continue;           /* Hunt for the start of a block. */
+        }
+
+        if(InjectFill == 1 && (Received == 0 || Received > TRACE_BLOCK_SAMPLES))
+        {
+            InjectFill = 0;     /* Not a block. */
+            continue;
+        }
+
+        Block[InjectFill++] = Received;
+
+        if(InjectFill < 2)
+        {
+            continue;
+        }
+
+        Length = TRACE_BLOCK_HEADER_BYTES + (2 * (Block[1] - 1));
+
+        if(InjectFill > Length)
+        {
+            byte Checksum = 0;
+
+            for(int Byte = 0; Byte < Length; Byte++)
+            {
+                Checksum += Block[Byte];
+            }
+
+            if(Checksum == Block[Length])
+            {
+                InjectReady[InjectFilling] = true;
+                InjectFilling ^= 1;
+                Block = InjectBlock[InjectFilling];
+            }
+
+            else
+            {
+                Serial.write(INJECT_NAK);
+                Serial.write(Block[2]);
+                Serial.write(Block[3]);
+            }
+
+            InjectFill = 0;
+        }
+    }
+}
+
+
+
+/******************************************************************************
+ InjectNextSample - Take the next pair of injected readings.
+
+Waits for the host if no block is ready, for up to INJECT_TIMEOUT_MILLIS, then
+ends injection so this pass, and every one after, reads the receivers.
+******************************************************************************/
+
+void InjectNextSample(void)
+{
+    byte *Block = InjectBlock[InjectUsing];
+    unsigned long InjectWaitStartTime = millis();
+
+    InjectReceive();
+
+    while(InjectReady[InjectUsing] == false)
+    {
+        if((millis() - InjectWaitStartTime) > INJECT_TIMEOUT_MILLIS)
+        {
+            Serial.end();       /* Host gone, back to the receivers. */
+            InjectMode = false;
+            return;
+        }
+
+        InjectReceive();
+    }
+
+    if(InjectPosition == 0)
+    {
+        InjectSample[0] = word(Block[5], Block[4]) & 0x3FF;
+        InjectSample[1] = word(Block[7], Block[6]) & 0x3FF;
+    }
+
+    else
+    {
+        InjectSample[0] += (int8_t)Block[TRACE_BLOCK_HEADER_BYTES + (2 * (InjectPosition - 1))];
+        InjectSample[1] += (int8_t)Block[TRACE_BLOCK_HEADER_BYTES + (2 * (InjectPosition - 1)) + 1];
+    }
+
+    InjectSampleCount++;
+    InjectPosition++;
+
+    if(InjectPosition >= Block[1])
+    {
+        Serial.write(INJECT_ACK);
+        Serial.write(Block[2]);
+        Serial.write(Block[3]);
+
+        InjectPosition = 0;
+        InjectReady[InjectUsing] = false;
+        InjectUsing ^= 1;
+    }
+}
+
+
+
+/******************************************************************************
+ InjectSwitch - Send a receiver switch back to the bench host.
+******************************************************************************/
+
+void InjectSwitch(void)
+{
+    unsigned long Now = millis();
+
+    Serial.write(INJECT_SWITCH);
+
+    for(int Byte = 0; Byte < 4; Byte++)
+    {
+        Serial.write((byte)(InjectSampleCount >> (8 * Byte)));
+    }
+
+    for(int Byte = 0; Byte < 4; Byte++)
+    {
+        Serial.write((byte)(Now >> (8 * Byte)));
+    }
+
+    Serial.write((byte)RxControlPinState);
+}
+
+
+
+/******************************************************************************
+ RSSIPairRead - Read both RSSI pins as a time-aligned pair.
+
+Reading RX1 then RX2 leaves RX2 two conversions behind, so on a fast fade the
+diversity logic compares two different moments. The pins are read A-B-B-A
+instead:
+
+    RX1  (RX2)  RX2  RX2  (RX1)  RX1
+     0     1     2    3     4     5     conversion
+
+The ADC is driven directly rather than through analogRead(). Each channel is
+selected one ADC clock into the conversion before it, so the multiplexer has
+settled by the time it is needed. The conversion after each switch, in
+brackets, is still thrown away to let the ADC sample capacitor settle. The two
+RX1 readings are centred on 2.5 conversions, as are the two RX2 readings, so
+averaging each pair cancels any linear change in RSSI across the sequence and
+the pair is effectively taken at the same moment. The ADC is left on RX1,
+ready for the next pair.
+
+Linear only holds over a short time, multipath notches at 5.8GHz last well
+under a millisecond. The ADC clock is raised to RSSI_ADC_PRESCALER for the
+pair so all six readings take 336us, the usual /128 clock is put back after.
+/64 is a 250kHz ADC clock, over the 200kHz the datasheet gives for full 10 bit
+results, traded for time: at /128 the pair takes 624us and its error on 600Hz
+fades is over three times that at /64. (tools/host/PairOrder)
+Calibration samples through here too, so the limits and the readings they
+scale come from the same clock.
+
+Results go in RSSI1InputPinValue and RSSI2InputPinValue.
+******************************************************************************/
+
+void RSSIPairRead(void)
+{
+    unsigned int RSSI1Early;
+    unsigned int RSSI2Early;
+    unsigned int RSSI2Late;
+    unsigned int RSSI1Late;
+    byte ADCSRASaved = ADCSRA;
+
+    if(FEATURE_INJECTION == true && InjectMode == true)
+    {
+        RSSI1InputPinValue = InjectSample[0];
+        RSSI2InputPinValue = InjectSample[1];
+        return;
+    }
+
+    ADCSRA = (ADCSRA & ~(_BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0))) | RSSI_ADC_PRESCALER;
+    ADMUX = (ADMUX & 0xF0) | (RSSI1_ADC_PIN - A0);
+
+    RSSI1Early = RSSIConvert(RSSI2_ADC_PIN);
+    RSSIConvert(RSSI2_ADC_PIN);             /* Sample capacitor settling. */
+    RSSI2Early = RSSIConvert(RSSI2_ADC_PIN);
+    RSSI2Late = RSSIConvert(RSSI1_ADC_PIN);
+    RSSIConvert(RSSI1_ADC_PIN);             /* Sample capacitor settling. */
+    RSSI1Late = RSSIConvert(RSSI1_ADC_PIN);
+
+    ADCSRA = ADCSRASaved;
+
+    RSSI1InputPinValue = (RSSI1Early + RSSI1Late + 1) >> 1;
+    RSSI2InputPinValue = (RSSI2Early + RSSI2Late + 1) >> 1;
+}
+
+
+
+/******************************************************************************
+ RSSIConvert - Convert the selected ADC channel, selecting Next once it starts.
+
+The channel is latched one ADC clock after the conversion starts. Selecting
+the next one then gives the multiplexer the rest of this conversion to settle.
+******************************************************************************/
+
+unsigned int RSSIConvert(int Next)
+{
+    ADCSRA |= _BV(ADSC);
+    delayMicroseconds(RSSI_ADC_CLOCK_MICROS);
+    ADMUX = (ADMUX & 0xF0) | (Next - A0);
+
+    while(ADCSRA & _BV(ADSC))
+    {
+        /* Wait for the conversion. */
+    }
+
+    return ADC;
+}
+
+
+
+/******************************************************************************
+ LatestReading - Most recent ADC reading stored in an RSSI averaging buffer.
+******************************************************************************/
+
+unsigned int LatestReading(unsigned int *Readings, unsigned int ReadIndex)
+{
+    return Readings[(ReadIndex == 0) ? (MAX_AVERAGE_READINGS - 1) : (ReadIndex - 1)];
+}
+
+
+
+/******************************************************************************
+ DisplayBargraph - Show RSSI on the four LEDs as a dimmed bargraph.
+
+The RSSI reading is scaled to 0-1024 between its calibration limits, 256 steps
+for each LED. LED_025_P has no PWM and lights as soon as there is any signal.
+The LED covering the current level is dimmed in proportion to how far
+the level is into it, LEDs below it are fully on. D9, D10 and D11 are driven
+by the hardware timers through analogWrite(), so dimming costs nothing between
+updates. Brightness goes through a gamma table so steps look even to the eye.
+With TRACKER_ENABLED Timer1 belongs to the servo, the D9 LED and the A2 LED
+are just switched on above half brightness.
+
+The displayed level only follows the RSSI once it has moved more than
+BARGRAPH_HYSTERESIS steps, which stops LEDs flickering on a boundary.
+******************************************************************************/
+
+void DisplayBargraph(unsigned int RSSIAverage, unsigned int RSSIMin, unsigned int RSSIMax)
+{
+    long Level = 0;
+
+    if(RSSIMax > RSSIMin)
+    {
+        Level = ((long)RSSIAverage - RSSIMin + 1) * BARGRAPH_FULL_SCALE / (RSSIMax - RSSIMin + 1);
+    }
+
+    if(Level < 0)
+    {
+        Level = 0;
+    }
+
+    else if(Level > BARGRAPH_FULL_SCALE)
+    {
+        Level = BARGRAPH_FULL_SCALE;
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(Level > BargraphLevel + BARGRAPH_HYSTERESIS)
+    {
+        BargraphLevel = Level - BARGRAPH_HYSTERESIS;
+    }
+
+    else if(Level < BargraphLevel - BARGRAPH_HYSTERESIS)
+    {
+        BargraphLevel = Level + BARGRAPH_HYSTERESIS;
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(Level == 0 || Level == BARGRAPH_FULL_SCALE)
+    {
+        BargraphLevel = Level;      /* Always reach the ends of the scale. */
+    }
+
+    digitalWrite(LED_025_P, (BargraphLevel > 0));
+
+    if(TRACKER_ENABLED == true)
+    {
+        digitalWrite(LED_050_P, (BargraphBrightness(BargraphLevel - BARGRAPH_SEGMENT) >= 128));   /* Timer1 runs at the servo frame rate, no dimming. */
+    }
+
+    else
+    {
+        analogWrite(LED_050_P, BargraphBrightness(BargraphLevel - BARGRAPH_SEGMENT));
+    }
+
+    analogWrite(LED_075_P, BargraphBrightness(BargraphLevel - (2 * BARGRAPH_SEGMENT)));
+    analogWrite(LED_100_P, BargraphBrightness(BargraphLevel - (3 * BARGRAPH_SEGMENT)));
+}
+
+
+
+/******************************************************************************
+ BargraphBrightness - PWM duty for one bargraph LED.
+
+Level is how far the bargraph extends into this LED, in bargraph steps.
+******************************************************************************/
+
+byte BargraphBrightness(int Level)
+{
+    if(Level <= 0)
+    {
+        return 0;
+    }
+
+    if(Level >= BARGRAPH_SEGMENT - 1)
+    {
+        return 255;
+    }
+
+    return pgm_read_byte(&BargraphGamma[Level]);
+}
+
+
+
+/******************************************************************************
+ UpdateRSSINoise - Adapt diversity hysteresis and toggle time to RSSI noise.
+
+The noise on each RSSI % is estimated from the smoothed square of its change
+between passes. Slow fades hardly move the averaged RSSI from one pass to the
+next so they are not mistaken for noise. For a moving average over N readings
+the variance of the average is N/2 times the mean squared change.
+The change is mostly 0 or 1%, so the smoothed square keeps
+RSSI_NOISE_FRACTION fraction bits, without them a 1% change is lost to the
+smoothing shift and the noise reads as none.
+
+The hysteresis is RSSI_NOISE_GAIN standard deviations of the difference
+between the two receivers, so noise alone rarely causes a toggle. The toggle
+time grows with the noise so a clean signal can follow fast fades and a noisy
+one can't thrash the video. tools/host/DiversityTraces holds the switch count
+and time on the weaker receiver to limits on synthetic traces.
+******************************************************************************/
+
+void UpdateRSSINoise(void)
+{
+    long RSSI1Change = RSSI1P - RSSI1PPrevious;
+    long RSSI2Change = RSSI2P - RSSI2PPrevious;
+
+    RSSI1PPrevious = RSSI1P;
+    RSSI2PPrevious = RSSI2P;
+
+    RSSI1NoiseSquared += ((RSSI1Change * RSSI1Change << (RSSI_NOISE_SHIFT + RSSI_NOISE_FRACTION)) - RSSI1NoiseSquared) >> RSSI_NOISE_SHIFT;
+    RSSI2NoiseSquared += ((RSSI2Change * RSSI2Change << (RSSI_NOISE_SHIFT + RSSI_NOISE_FRACTION)) - RSSI2NoiseSquared) >> RSSI_NOISE_SHIFT;
+
+    /* Variance of (RSSI1P - RSSI2P), % squared. */
+    float NoiseVariance = (float)(RSSI1NoiseSquared + RSSI2NoiseSquared) * MAX_AVERAGE_READINGS / (2L << (RSSI_NOISE_SHIFT + RSSI_NOISE_FRACTION));
+    float Noise = sqrt(NoiseVariance);
+
+    DiversityHysteresis = RSSI_NOISE_GAIN * Noise;
+
+    if(DiversityHysteresis < RSSI_HYSTERESIS)
+    {
+        DiversityHysteresis = RSSI_HYSTERESIS;
+    }
+
+    else if(DiversityHysteresis > RSSI_HYSTERESIS_MAX)
+    {
+        DiversityHysteresis = RSSI_HYSTERESIS_MAX;
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    DiversityIntervalMillis = DIVERSITY_INTERVAL_MIN_MILLIS + (unsigned long)(Noise * DIVERSITY_NOISE_MILLIS);
+
+    if(DiversityIntervalMillis > DIVERSITY_INTERVAL_MILLIS)
+    {
+        DiversityIntervalMillis = DIVERSITY_INTERVAL_MILLIS;
+    }
+}
+
+
+
+/******************************************************************************
+ UpdateDiversityPolicy - Pick the diversity policy, update its noise and trend
+ terms.
+
+The policy in use is DiversityPolicy, or SPECTRUM_POLICY whilst the spectrum
+analyser is shown. The noise and trend terms of POLICY_SCORED are kept up to
+date whichever policy is in use, so switching to it doesn't start from
+nothing.
+
+The spread of each receiver's ADC readings about its average is tracked from
+every pass, as the averaged RSSI % hides it. The noise and trend terms are
+only worked out every POLICY_UPDATE_MILLIS, so the square root and divide are
+kept off most passes, and are smoothed over POLICY_BONUS_SMOOTH updates. Each
+update is taken from a noisy estimate of the spread and a 50ms difference of
+a noisy average, unsmoothed they jitter by a few % between updates, which the
+hysteresis, measured on the averaged RSSI % alone, doesn't cover.
+******************************************************************************/
+
+void UpdateDiversityPolicy(void)
+{
+    long Spread1 = (long)RSSI1InputPinValue - RSSI1Average;
+    long Spread2 = (long)RSSI2InputPinValue - RSSI2Average;
+
+    PolicyVariance[0] += ((Spread1 * Spread1 << RSSI_NOISE_SHIFT) - PolicyVariance[0]) >> RSSI_NOISE_SHIFT;
+    PolicyVariance[1] += ((Spread2 * Spread2 << RSSI_NOISE_SHIFT) - PolicyVariance[1]) >> RSSI_NOISE_SHIFT;
+
+    DiversityPolicyActive = (VideoSwitchCounter == 2) ? SPECTRUM_POLICY : DiversityPolicy;
+
+    if((millis() - PolicyPreviousTime) >= POLICY_UPDATE_MILLIS)
+    {
+        PolicyPreviousTime = millis();
+
+        for(int Rx = 0; Rx < 2; Rx++)
+        {
+            int Level = (Rx == 0) ? RSSI1P : RSSI2P;
+            int Span = (Rx == 0) ? (RSSI1Max - RSSI1Min) : (RSSI2Max - RSSI2Min);
+            float Noise = (Span > 0) ? sqrt((float)PolicyVariance[Rx] / (1 << RSSI_NOISE_SHIFT)) * 100 / Span : 0;    /* ADC steps to %. */
+            float Bonus = (POLICY_TREND_WEIGHT * (Level - PolicyTrendPrevious[Rx])) - (POLICY_NOISE_WEIGHT * Noise);
+
+            PolicyBonusSmoothed[Rx] += (Bonus - PolicyBonusSmoothed[Rx]) / POLICY_BONUS_SMOOTH;
+            PolicyBonus[Rx] = constrain((int)floor(PolicyBonusSmoothed[Rx] + 0.5), -POLICY_BONUS_MAX, POLICY_BONUS_MAX);
+            PolicyTrendPrevious[Rx] = Level;
+        }
+    }
+}
+
+
+
+/******************************************************************************
+ DiversityDecide - Score the receivers and pick one, under the policy in use.
+
+Each policy is one function, given the receiver selected and the time since
+the last switch, that fills in DiversityScore[] and returns the receiver it
+wants, LOW for RX1 or HIGH for RX2. The mode 3 logic only adds receiver
+health on top. A new policy needs a POLICY_ number below POLICY_COUNT and its
+function in the table here, in the same place.
+
+ POLICY_LEVEL   Score is the averaged RSSI %.
+ POLICY_SCORED  Score is the averaged RSSI %, less POLICY_NOISE_WEIGHT times
+                the spread of the receiver's ADC readings about its average,
+                plus POLICY_TREND_WEIGHT times its rise over the last
+                POLICY_UPDATE_MILLIS. A steady receiver is preferred to an
+                equally strong noisy one, and a fading receiver is left sooner.
+ POLICY_FREEZE  Scores as POLICY_LEVEL, but stays on the selected receiver.
+
+POLICY_SERIAL_CYCLE steps DiversityPolicy through them all in debug mode.
+tools/host/PolicyAB compares them, and their loop time, on the same signals.
+******************************************************************************/
+
+int DiversityDecide(int Selected, unsigned long Elapsed)
+{
+    static int (* const Policies[POLICY_COUNT])(int Selected, unsigned long Elapsed) = { PolicyLevel, PolicyScored, PolicyFreeze };
+
+    return Policies[DiversityPolicyActive](Selected, Elapsed);
+}
+
+
+
+/******************************************************************************
+ DiversityCompare - The other receiver, if its score beats the selected one by
+ the hysteresis and the toggle time is up, otherwise the selected one.
+******************************************************************************/
+
+int DiversityCompare(int Selected, unsigned long Elapsed)
+{
+    if(Elapsed <= DiversityIntervalMillis)
+    {
+        return Selected;
+    }
+
+    else if(Selected == HIGH && DiversityScore[0] > DiversityScore[1] + DiversityHysteresis)
+    {
+        return LOW;
+    }
+
+    else if(Selected == LOW && DiversityScore[1] > DiversityScore[0] + DiversityHysteresis)
+    {
+        return HIGH;
+    }
+
+    else
+    {
+        return Selected;
+    }
+}
+
+
+
+/******************************************************************************
+ PolicyLevel - POLICY_LEVEL decision function. (see DiversityDecide)
+******************************************************************************/
+
+int PolicyLevel(int Selected, unsigned long Elapsed)
+{
+    DiversityScore[0] = RSSI1P;
+    DiversityScore[1] = RSSI2P;
+
+    return DiversityCompare(Selected, Elapsed);
+}
+
+
+
+/******************************************************************************
+ PolicyScored - POLICY_SCORED decision function. (see DiversityDecide)
+******************************************************************************/
+
+int PolicyScored(int Selected, unsigned long Elapsed)
+{
+    DiversityScore[0] = RSSI1P + PolicyBonus[0];
+    DiversityScore[1] = RSSI2P + PolicyBonus[1];
+
+    return DiversityCompare(Selected, Elapsed);
+}
+
+
+
+/******************************************************************************
+ PolicyFreeze - POLICY_FREEZE decision function. (see DiversityDecide)
+******************************************************************************/
+
+int PolicyFreeze(int Selected, unsigned long Elapsed)
+{
+    (void)Elapsed;      /* Never switches, the toggle time doesn't matter. */
+
+    DiversityScore[0] = RSSI1P;
+    DiversityScore[1] = RSSI2P;
+
+    return Selected;
+}
+
+
+
+/******************************************************************************
+ StatsReset - Clear link statistics.
+
+Every figure is kept as a running value so that statistics cost the same
+for each pass through the loop no matter how long the unit has been running.
+Called at power up, when both buttons are held and on a serial request.
+******************************************************************************/
+
+void StatsReset(void)
+{
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        StatsSamples[Rx] = 0;
+        StatsMean[Rx] = 0;
+        StatsM2[Rx] = 0;
+        StatsMin[Rx] = 1023;
+        StatsMax[Rx] = 0;
+        StatsSelectedMillis[Rx] = 0;
+        StatsInOutage[Rx] = false;
+        StatsOutageCount[Rx] = 0;
+        StatsOutageMillis[Rx] = 0;
+
+        for(int Bin = 0; Bin < STATS_HISTOGRAM_BINS; Bin++)
+        {
+            StatsHistogram[Rx][Bin] = 0;
+        }
+    }
+
+    StatsDiversityMillis = 0;
+    StatsSwitchCount = 0;
+    StatsLongestDwellMillis = 0;
+    StatsPreviousTime = millis();
+    StatsDwellStartTime = StatsPreviousTime;
+    StatsPreviousRxState = RxControlPinState;
+    LoopMicrosMax = 0;
+    LoopMicrosTotal = 0;
+    LoopCount = 0;
+    LoopPreviousMicros = micros();
+}
+
+
+
+/******************************************************************************
+ StatsUpdate - Fold the current pass through the loop into link statistics.
+
+Time since the previous update is credited to the receiver that was selected
+during that time. Receiver switches are only counted in diversity mode, a
+dwell is the time between two diversity switches.
+******************************************************************************/
+
+void StatsUpdate(void)
+{
+    unsigned long StatsCurrentTime = millis();
+    unsigned long StatsElapsed = StatsCurrentTime - StatsPreviousTime;
+
+    StatsAccumulate(0, RSSI1Average, RSSI1P, StatsElapsed);
+    StatsAccumulate(1, RSSI2Average, RSSI2P, StatsElapsed);
+
+    StatsSelectedMillis[(StatsPreviousRxState == LOW) ? 0 : 1] += StatsElapsed;
+
+    if(ModeSwitchCounter == 3)
+    {
+        StatsDiversityMillis += StatsElapsed;
+
+        if(RxControlPinState != StatsPreviousRxState)
+        {
+            StatsSwitchCount++;
+
+            if((StatsCurrentTime - StatsDwellStartTime) > StatsLongestDwellMillis)
+            {
+                StatsLongestDwellMillis = StatsCurrentTime - StatsDwellStartTime;
+            }
+
+            StatsDwellStartTime = StatsCurrentTime;
+        }
+    }
+
+    else
+    {
+        StatsDwellStartTime = StatsCurrentTime;     /* Dwell only counts whilst diversity is active. */
+    }
+
+    StatsPreviousRxState = RxControlPinState;
+    StatsPreviousTime = StatsCurrentTime;
+}
+
+
+
+/******************************************************************************
+ StatsAccumulate - Add one averaged RSSI sample to a receiver's statistics.
+
+Mean and variance use Welford's method so no sample history is required.
+******************************************************************************/
+
+void StatsAccumulate(int Rx, unsigned int Sample, int Percent, unsigned long Elapsed)
+{
+    float Delta = Sample - StatsMean[Rx];
+    int Bin = Sample >> STATS_HISTOGRAM_SHIFT;
+
+    StatsSamples[Rx]++;
+    StatsMean[Rx] += Delta / StatsSamples[Rx];
+    StatsM2[Rx] += Delta * (Sample - StatsMean[Rx]);
+
+    if(Sample < StatsMin[Rx])
+    {
+        StatsMin[Rx] = Sample;
+    }
+
+    if(Sample > StatsMax[Rx])
+    {
+        StatsMax[Rx] = Sample;
+    }
+
+    if(Bin >= STATS_HISTOGRAM_BINS)
+    {
+        Bin = STATS_HISTOGRAM_BINS - 1;
+    }
+
+    StatsHistogram[Rx][Bin]++;
+
+    if(Percent < STATS_OUTAGE_LEVEL)
+    {
+        if(StatsInOutage[Rx] == false)
+        {
+            StatsInOutage[Rx] = true;
+            StatsOutageCount[Rx]++;
+        }
+
+        StatsOutageMillis[Rx] += Elapsed;
+    }
+
+    else
+    {
+        StatsInOutage[Rx] = false;
+    }
+}
+
+
+
+/******************************************************************************
+ StatsPrint - Dump link statistics to the serial console.
+
+Only available in serial debug mode. Send STATS_SERIAL_QUERY to print.
+******************************************************************************/
+
+void StatsPrint(void)
+{
+    unsigned long LongestDwell = StatsLongestDwellMillis;
+
+    if((ModeSwitchCounter == 3) && ((millis() - StatsDwellStartTime) > LongestDwell))
+    {
+        LongestDwell = millis() - StatsDwellStartTime;    /* Current dwell may be the longest. */
+    }
+
+    Serial.println(F("  "));
+    Serial.println(F("LINK STATISTICS"));
+
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        Serial.print(F("RX"));
+        Serial.print(Rx + 1);
+        Serial.print(F("  SAMPLES ="));
+        Serial.print(StatsSamples[Rx]);
+        Serial.print(F("  MEAN ="));
+        Serial.print(StatsMean[Rx]);
+        Serial.print(F("  STDDEV ="));
+        Serial.print((StatsSamples[Rx] > 1) ? sqrt(StatsM2[Rx] / (StatsSamples[Rx] - 1)) : 0.0);
+        Serial.print(F("  MIN / MAX ="));
+        Serial.print(StatsMin[Rx]);
+        Serial.print(F(" / "));
+        Serial.println(StatsMax[Rx]);
+
+        Serial.print(F("RX"));
+        Serial.print(Rx + 1);
+        Serial.print(F("  SELECTED MS ="));
+        Serial.print(StatsSelectedMillis[Rx]);
+        Serial.print(F("  OUTAGES ="));
+        Serial.print(StatsOutageCount[Rx]);
+        Serial.print(F("  OUTAGE MS ="));
+        Serial.println(StatsOutageMillis[Rx]);
+
+        Serial.print(F("RX"));
+        Serial.print(Rx + 1);
+        Serial.print(F("  HISTOGRAM ="));
+
+        for(int Bin = 0; Bin < STATS_HISTOGRAM_BINS; Bin++)
+        {
+            Serial.print(F(" "));
+            Serial.print(StatsHistogram[Rx][Bin]);
+        }
+
+        Serial.println(F(" "));
+    }
+
+    Serial.print(F("DIVERSITY  SWITCHES ="));
+    Serial.print(StatsSwitchCount);
+    Serial.print(F("  SWITCHES / MIN ="));
+    Serial.print((StatsDiversityMillis > 0) ? (StatsSwitchCount * 60000.0 / StatsDiversityMillis) : 0.0);
+    Serial.print(F("  LONGEST DWELL MS ="));
+    Serial.println(LongestDwell);
+
+    if(FEATURE_INSTRUMENTATION == true)
+    {
+        Serial.print(F("LOOP  PASSES ="));
+        Serial.print(LoopCount);
+        Serial.print(F("  MEAN US ="));
+        Serial.print((LoopCount > 0) ? (LoopMicrosTotal / LoopCount) : 0);
+        Serial.print(F("  MAX US ="));
+        Serial.println(LoopMicrosMax);
+
+        LoopPreviousMicros = micros();     /* Don't time the print. */
+    }
+}
+
+
+
+/******************************************************************************
+ LoopTiming - Time each pass through the loop. (PROFILE_BENCH)
+
+Passes are timed start to start, so debug output and trace are included. The
+mean and longest pass are printed with the link statistics and cleared with
+them. Timing restarts after a statistics print so the print isn't counted.
+******************************************************************************/
+
+void LoopTiming(void)
+{
+    unsigned long LoopCurrentMicros = micros();
+
+    LoopMicros = LoopCurrentMicros - LoopPreviousMicros;
+    LoopPreviousMicros = LoopCurrentMicros;
+
+    LoopCount++;
+    LoopMicrosTotal += LoopMicros;
+
+    if(LoopMicros > LoopMicrosMax)
+    {
+        LoopMicrosMax = LoopMicros;
+    }
+}
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ Arduino.h - Just enough of the Arduino core to run Div4RX5808-PRO on a PC.
+
+Time is virtual: HostMicros only moves when the sketch does something that
+takes time on the ATmega328 (a conversion, a delay, a pin access, reading the
+time) or when a test driver moves it. HostTick, if set, is called each time
+the sketch moves it, so a driver can run its model and watch for hangs inside
+a single loop() pass. Every ADC conversion, analogRead() or started through
+ADCSRA, asks HostADC for its value so a driver can model receivers,
+faults and multiplexer effects down to the order of conversions. As in the
+core, analogRead() puts the analogReference() into ADMUX, so a driver can
+tell from ADMUX which reference a conversion is made against.
+
+Serial output is collected in HostSerialOut, input is taken from HostSerialIn.
+Output takes its time at the baud rate given to Serial.begin() through a 64
+byte transmit buffer, as on the board, so a write waits when the buffer is
+full.
+*******************************************************************************/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define DEFAULT 1
+#define EXTERNAL 0
+#define INTERNAL 3
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define PROGMEM
+#define F(s) s
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define _BV(b) (1 << (b))
+#define lowByte(w) ((uint8_t)((w) & 0xFF))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define word(h, l) ((uint16_t)(((h) << 8) | (l)))
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+#define SERIAL_TX_BUFFER_SIZE 64
+#define ISR(Vector) extern "C" void Vector(void)
+
+/* Registers the sketch touches. */
+#define REFS0 6
+#define REFS1 7
+#define ADLAR 5
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define ADEN 7
+#define ADSC 6
+#define ADIF 4
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define COM1B1 5
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define CS11 1
+#define TOIE1 0
+
+/* Writing ADSC to ADCSRA runs a conversion on the channel in ADMUX at once. */
+struct HostADCSRA
+{
+    uint8_t Value;
+    HostADCSRA &operator=(uint8_t Bits);
+    HostADCSRA &operator|=(uint8_t Bits) { return *this = Value | Bits; }
+    HostADCSRA &operator&=(uint8_t Bits) { Value &= Bits; return *this; }
+    operator uint8_t() const { return Value; }
+};
+
+extern HostADCSRA ADCSRA;
+extern volatile uint8_t ADMUX, ADCL, ADCH, MCUSR, TCCR1A, TCCR1B, TIMSK1, TCCR2A, TCCR2B, TIMSK2, OCR2A;
+extern volatile uint16_t ADC, ICR1, OCR1A, OCR1B, TCNT1;
+
+void pinMode(uint8_t Pin, uint8_t Mode);
+void digitalWrite(uint8_t Pin, uint8_t Value);
+int digitalRead(uint8_t Pin);
+int analogRead(uint8_t Pin);
+void analogReference(uint8_t Mode);
+void analogWrite(uint8_t Pin, int Value);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long Millis);
+void delayMicroseconds(unsigned int Micros);
+long map(long Value, long FromLow, long FromHigh, long ToLow, long ToHigh);
+void noInterrupts(void);
+void interrupts(void);
+
+struct HostSerial
+{
+    void begin(long Baud);
+    void end(void);
+    int available(void);
+    int read(void);
+    int availableForWrite(void);
+    void flush(void);
+    operator bool(void) { return true; }
+    size_t write(uint8_t Byte);
+    size_t write(const uint8_t *Bytes, size_t Count);
+
+    void print(const char *Text) { write((const uint8_t *)Text, strlen(Text)); }
+    void print(char Character) { write((uint8_t)Character); }
+    void print(long Value) { char Text[24]; snprintf(Text, sizeof(Text), "%ld", Value); print(Text); }
+    void print(unsigned long Value) { char Text[24]; snprintf(Text, sizeof(Text), "%lu", Value); print(Text); }
+    void print(int Value) { print((long)Value); }
+    void print(unsigned int Value) { print((unsigned long)Value); }
+    void print(unsigned char Value) { print((unsigned long)Value); }
+    void print(bool Value) { print((long)Value); }
+    void print(double Value, int Digits = 2) { char Text[40]; snprintf(Text, sizeof(Text), "%.*f", Digits, Value); print(Text); }
+    template<class T> void println(T Value) { print(Value); print("\r\n"); }
+    template<class T> void println(T Value, int Digits) { print(Value, Digits); print("\r\n"); }
+    void println(void) { print("\r\n"); }
+};
+
+extern HostSerial Serial;
+
+/* Test driver side. */
+extern unsigned long HostMicros;                        /* Virtual time. */
+extern int HostPin[20];                                 /* Levels read by digitalRead(), written by digitalWrite(). */
+extern int HostPWM[20];                                 /* Last analogWrite() value. */
+extern int (*HostADC)(int Channel);                     /* Value of a conversion on ADC channel 0-15. Default HostADCValue[]. */
+extern int HostADCValue[16];
+extern void (*HostTick)(void);                          /* Called whenever the sketch moves HostMicros. */
+extern int HostLastChannel;                             /* Channel of the previous conversion. */
+extern int HostLastConversion;                          /* Result of the previous conversion, what a floating input picks up. */
+extern unsigned long HostConversions;
+extern std::vector<uint8_t> HostSerialOut;
+extern std::vector<uint8_t> HostSerialIn;
+extern char __data_load_end;
+
+#endif
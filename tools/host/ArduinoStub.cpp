@@ -0,0 +1,146 @@
+/*******************************************************************************
+ ArduinoStub.cpp - Host side of Arduino.h. (see Arduino.h)
+*******************************************************************************/
+
+#include "Arduino.h"
+
+HostADCSRA ADCSRA = { _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0) };    /* As the core leaves it, /128. */
+volatile uint8_t ADMUX, ADCL, ADCH, MCUSR, TCCR1A, TCCR1B, TIMSK1, TCCR2A, TCCR2B, TIMSK2, OCR2A;
+volatile uint16_t ADC, ICR1, OCR1A, OCR1B, TCNT1;
+HostSerial Serial;
+char __data_load_end;
+
+unsigned long HostMicros = 0;
+int HostPin[20];
+int HostPWM[20];
+int HostADCValue[16] = { 600, 600, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 225, 0 };     /* Channel 14 is the bandgap, 1V1 on a 5V reference. */
+int HostLastChannel = 0;
+int HostLastConversion = 0;
+unsigned long HostConversions = 0;
+std::vector<uint8_t> HostSerialOut;
+std::vector<uint8_t> HostSerialIn;
+static unsigned long ByteMicros = 0;                    /* Time to send one byte, 0 with the port closed. */
+static unsigned long SentMicros = 0;                    /* Time the transmit buffer will be empty. */
+static uint8_t Reference = DEFAULT;                     /* Set by analogReference(), used from the next analogRead(). */
+
+static int HostADCDefault(int Channel) { return HostADCValue[Channel]; }
+int (*HostADC)(int Channel) = HostADCDefault;
+void (*HostTick)(void) = 0;
+
+static void Advance(unsigned long Micros)
+{
+    HostMicros += Micros;
+
+    if(HostTick != 0)
+    {
+        HostTick();
+    }
+}
+
+static int Convert(int Channel, unsigned long Micros)
+{
+    int Value = HostADC(Channel);
+
+    Value = constrain(Value, 0, 1023);
+    Advance(Micros);
+    HostLastChannel = Channel;
+    HostLastConversion = Value;
+    HostConversions++;
+    ADC = Value;
+    ADCL = lowByte(Value);
+    ADCH = highByte(Value);
+    return Value;
+}
+
+HostADCSRA &HostADCSRA::operator=(uint8_t Bits)
+{
+    Value = Bits;
+
+    if(Bits & _BV(ADSC))
+    {
+        int Prescaler = 1 << (Bits & 7);
+        Convert(ADMUX & 0x0F, (13 * (Prescaler < 2 ? 2 : Prescaler)) / 16);
+        Value &= ~_BV(ADSC);
+        Value |= _BV(ADIF);
+    }
+
+    return *this;
+}
+
+int analogRead(uint8_t Pin)
+{
+    int Channel = (Pin >= A0) ? Pin - A0 : Pin;
+
+    ADMUX = (Reference << REFS0) | Channel;
+    return Convert(Channel, 112);       /* 13 clocks at /128 and the core's overhead. */
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t Pin, uint8_t Value) { HostPin[Pin] = Value; Advance(4); }
+int digitalRead(uint8_t Pin) { Advance(4); return HostPin[Pin]; }
+void analogReference(uint8_t Mode) { Reference = Mode; }
+void analogWrite(uint8_t Pin, int Value) { HostPWM[Pin] = Value; HostPin[Pin] = Value > 127; }
+unsigned long millis(void) { Advance(1); return HostMicros / 1000; }
+unsigned long micros(void) { Advance(1); return HostMicros; }
+void delay(unsigned long Millis) { Advance(Millis * 1000); }
+void delayMicroseconds(unsigned int Micros) { Advance(Micros); }
+long map(long Value, long FromLow, long FromHigh, long ToLow, long ToHigh) { return (Value - FromLow) * (ToHigh - ToLow) / (FromHigh - FromLow) + ToLow; }
+void noInterrupts(void) {}
+void interrupts(void) {}
+
+void HostSerial::begin(long Baud) { ByteMicros = 10000000 / Baud; SentMicros = HostMicros; }
+void HostSerial::end(void) { flush(); ByteMicros = 0; }
+int HostSerial::available(void) { return HostSerialIn.size(); }
+void HostSerial::flush(void) { if(SentMicros > HostMicros) Advance(SentMicros - HostMicros); }
+
+/* Bytes still in the transmit buffer, draining at the baud rate. */
+static unsigned long Queued(void)
+{
+    if(ByteMicros == 0 || SentMicros <= HostMicros)
+    {
+        return 0;
+    }
+
+    return (SentMicros - HostMicros + ByteMicros - 1) / ByteMicros;
+}
+
+int HostSerial::availableForWrite(void) { Advance(1); return SERIAL_TX_BUFFER_SIZE - 1 - Queued(); }
+
+int HostSerial::read(void)
+{
+    if(HostSerialIn.empty())
+    {
+        return -1;
+    }
+
+    int Byte = HostSerialIn[0];
+    HostSerialIn.erase(HostSerialIn.begin());
+    return Byte;
+}
+
+/* As the core does, waits whilst the transmit buffer is full. */
+size_t HostSerial::write(uint8_t Byte)
+{
+    if(ByteMicros > 0)
+    {
+        if(Queued() >= SERIAL_TX_BUFFER_SIZE - 1)
+        {
+            Advance(SentMicros - HostMicros - ((SERIAL_TX_BUFFER_SIZE - 2) * ByteMicros));
+        }
+
+        SentMicros = ((SentMicros > HostMicros) ? SentMicros : HostMicros) + ByteMicros;
+    }
+
+    HostSerialOut.push_back(Byte);
+    return 1;
+}
+
+size_t HostSerial::write(const uint8_t *Bytes, size_t Count)
+{
+    for(size_t Byte = 0; Byte < Count; Byte++)
+    {
+        write(Bytes[Byte]);
+    }
+
+    return Count;
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ BandgapCheck - The ADC reference check against the loop and the RSSI readings.
+
+    tools/host/build.sh tools/host/BandgapCheck.cpp build/BandgapCheck && build/BandgapCheck
+
+Powers up in diversity and runs the loop for RUN_SECONDS of virtual time, with
+the bandgap moving BANDGAP_STEP up at STEP_SECONDS. Every conversion is
+checked against the reference in ADMUX: an RSSI conversion against AVcc, or
+against INTERNAL within BANDGAP_SETTLE_MILLIS of the last conversion against
+AVcc, has read AREF on its way back down to 1V1 and is counted as unsettled.
+Prints the time setup() takes, the longest loop pass, the unsettled RSSI
+conversions, and RSSI1Max against what the new bandgap should have made it.
+Fails if setup() or any pass takes longer than LIMIT_MICROS, any RSSI
+conversion is unsettled, or RSSI1Max is more than one step out.
+*******************************************************************************/
+
+#include "Sketch.cpp"
+
+#define RUN_SECONDS 70
+#define STEP_SECONDS 40
+#define BANDGAP_STEP 11                                 /* ADC steps on the bandgap channel, about 5%. */
+#define LIMIT_MICROS 5000
+
+unsigned long LastAVcc = 0;                             /* Time of the last conversion against AVcc, 0 = none. */
+unsigned long Unsettled = 0;
+unsigned long Conversions = 0;
+
+int CheckADC(int Channel)
+{
+    int Reference = ADMUX >> REFS0;
+
+    if(Reference == DEFAULT)
+    {
+        LastAVcc = HostMicros;
+    }
+
+    else if(Channel < 2)
+    {
+        Conversions++;
+        Unsettled += (Reference != INTERNAL) ||
+            (LastAVcc != 0 && (HostMicros - LastAVcc) < (BANDGAP_SETTLE_MILLIS * 1000UL));
+    }
+
+    else
+    {
+        /* Do Nothing */
+    }
+
+    if(Channel < 2)
+    {
+        return 700 + (rand() % 21) - 10;
+    }
+
+    return HostADCValue[Channel];
+}
+
+int main(void)
+{
+    HostADC = CheckADC;
+    HostPin[MODE_SWITCH] = HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    setup();
+
+    unsigned long Setup = HostMicros;
+    unsigned long Longest = 0;
+    unsigned long Base = 0;
+
+    ModeSwitchCounter = 3;                              /* Diversity. */
+
+    while(HostMicros < RUN_SECONDS * 1000000UL)
+    {
+        unsigned long Previous = HostMicros;
+
+        if(HostMicros >= STEP_SECONDS * 1000000UL && Base == 0)
+        {
+            Base = RSSI1Max;
+            HostADCValue[14] += BANDGAP_STEP;
+        }
+
+        loop();
+        Longest = (HostMicros - Previous > Longest) ? HostMicros - Previous : Longest;
+    }
+
+    unsigned long Wanted = (unsigned long)RSSI1MaxBase * BandgapBase / (BANDGAP_READINGS * HostADCValue[14]);
+    bool Failed = Setup > LIMIT_MICROS || Longest > LIMIT_MICROS || Unsettled != 0 ||
+        (long)RSSI1Max - (long)Wanted > 1 || (long)Wanted - (long)RSSI1Max > 1;
+
+    printf("setup             %6lu us\n", Setup);
+    printf("longest pass      %6lu us\n", Longest);
+    printf("unsettled RSSI    %6lu of %lu conversions\n", Unsettled, Conversions);
+    printf("RSSI1Max          %6u, was %lu, wanted %lu\n", RSSI1Max, Base, Wanted);
+    printf("%s\n", Failed ? "FAIL" : "PASS");
+
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ DecisionFades - Capture decision dumps across crossing fades, for DecisionLatency.
+
+    tools/host/build.sh tools/host/DecisionFades.cpp build/DecisionFades
+    build/DecisionFades directory && DecisionLatency directory/quiet.cap directory/text.cap
+
+Powers up in serial debug mode and makes the two receivers cross over every
+FADE_PERIOD_MILLIS, each crossing taking FADE_MILLIS, dumping the decision
+trace ('d') FADE_PERIOD_MILLIS / 2 after each. Every second crossing comes
+soon after the previous switch, so dwell shows up. This is done with the debug
+text stopped ('q'), written to quiet.cap, and with it running, text.cap, to
+show what the text does to the latencies. Each capture is the serial output
+as a PC would log it.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include "Sketch.cpp"
+
+#define FADES 20
+#define FADE_MILLIS 50                                  /* Time for the receivers to swap levels. */
+#define FADE_PERIOD_MILLIS 3000
+#define FADE_SOON_MILLIS 190                            /* Every second crossing follows the one before this soon. */
+#define LEVEL_HIGH 850
+#define LEVEL_LOW 650
+
+/* Crossings at 0, 190, 3000, 3190, ... after the start, alternating direction. */
+int Level(int Rx)
+{
+    long Millis = (long)millis() - 2000;
+    long Since = -1;
+    int Crossings = 0;
+
+    for(int Fade = 0; Fade < FADES; Fade++)
+    {
+        long At = ((Fade / 2) * FADE_PERIOD_MILLIS) + ((Fade % 2) * FADE_SOON_MILLIS);
+
+        if(Millis >= At)
+        {
+            Crossings = Fade + 1;
+            Since = Millis - At;
+        }
+    }
+
+    double Mix = (Since < 0) ? 0 : ((Since < FADE_MILLIS) ? (double)Since / FADE_MILLIS : 1);
+    double Swapped = ((Crossings % 2) == 1) ? Mix : 1 - Mix;
+    double High = (Rx == 0) ? 1 - Swapped : Swapped;
+
+    if(Crossings == 0)
+    {
+        High = (Rx == 0) ? 1 : 0;
+    }
+
+    return LEVEL_LOW + (int)((LEVEL_HIGH - LEVEL_LOW) * High) + (rand() % 5) - 2;
+}
+
+int FadeADC(int Channel)
+{
+    return (Channel < 2) ? Level(Channel) : HostADCValue[Channel];
+}
+
+void Capture(const char *Path, bool Quiet)
+{
+    HostADC = FadeADC;
+    HostPin[MODE_SWITCH] = LOW;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    setup();
+    HostPin[MODE_SWITCH] = HIGH;
+    ModeSwitchCounter = 3;
+
+    while(millis() < 1500)
+    {
+        loop();
+    }
+
+    if(Quiet == true)
+    {
+        HostSerialIn.push_back(DECISION_SERIAL_QUIET);
+    }
+
+    HostSerialIn.push_back(DECISION_SERIAL_DUMP);      /* Start from an empty ring. */
+
+    for(int Fade = 0; Fade < FADES; Fade += 2)
+    {
+        unsigned long DumpAt = 2000 + ((Fade / 2) * FADE_PERIOD_MILLIS) + (FADE_PERIOD_MILLIS / 2);
+
+        while(millis() < DumpAt)
+        {
+            loop();
+        }
+
+        HostSerialIn.push_back(DECISION_SERIAL_DUMP);
+    }
+
+    loop();
+
+    FILE *File = fopen(Path, "wb");
+
+    if(File == 0)
+    {
+        perror(Path);
+        _exit(1);
+    }
+
+    fwrite(HostSerialOut.data(), 1, HostSerialOut.size(), File);
+    fclose(File);
+    _exit(0);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s directory\n", argv[0]);
+        return 2;
+    }
+
+    std::string Quiet = std::string(argv[1]) + "/quiet.cap";
+    std::string Text = std::string(argv[1]) + "/text.cap";
+    int Status;
+    int Failed = 0;
+
+    if(fork() == 0)
+    {
+        Capture(Quiet.c_str(), true);
+    }
+
+    wait(&Status);
+    Failed += (WIFEXITED(Status) == 0 || WEXITSTATUS(Status) != 0);
+
+    if(fork() == 0)
+    {
+        Capture(Text.c_str(), false);
+    }
+
+    wait(&Status);
+    Failed += (WIFEXITED(Status) == 0 || WEXITSTATUS(Status) != 0);
+    return Failed > 0;
+}
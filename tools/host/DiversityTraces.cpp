@@ -0,0 +1,198 @@
+/*******************************************************************************
+ DiversityTraces - Switch count against time on the weaker receiver.
+
+    tools/host/build.sh tools/host/DiversityTraces.cpp build/DiversityTraces && build/DiversityTraces
+
+Runs the adaptive hysteresis and toggle time of UpdateRSSINoise(), under each
+live video policy, through synthetic fade and noise traces for RUN_SECONDS of
+virtual time. Counts the receiver switches and the time spent on the weaker
+receiver, where the two signals before noise are more than WEAKER_MARGIN
+apart, from SETTLE_MICROS on. Each trace has a most switches and a most time
+on the weaker receiver that any policy may take:
+
+  clean tie        both at 700, +-3 of noise: nothing to switch for.
+  noisy tie        both at 700, +-40: noise alone mustn't switch.
+  noisy vs steady  RX1 at 800 +-35, RX2 at 790 +-4: the PolicyAB thrash.
+  noisy gap        RX1 at 760 +-40, RX2 at 700 +-40: stay on RX1.
+  clean step       RX1 at 800 drops to 500 at 4 s, RX2 at 700: one switch, quick.
+  clean fades      the receivers cross 150 either side of 750 at 0.5Hz.
+  noisy fades      as clean fades, +-40 on both.
+  dropouts         RX1 at 800 +-10 dropping to 300 for 40 ms every 1.1 s, RX2
+                   at 700 +-10: short dropouts may be followed, not thrashed.
+
+Prints the figures and limits of every run and exits non-zero if any is over.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Sketch.cpp"
+
+#define RUN_SECONDS 12
+#define PASS_MICROS 300                                 /* Loop time spent away from the ADC, added to every pass. */
+#define SETTLE_MICROS 500000                            /* Not counted, the averages filling. */
+#define WEAKER_MARGIN 15                                /* ADC steps between the signals before one counts as weaker. */
+
+struct Trace
+{
+    const char *Name;
+    unsigned long MaxSwitches;
+    double MaxWeaker;                                   /* % of the counted time. */
+};
+
+const Trace Traces[] =
+{
+    { "clean tie",        0,  0.0 },
+    { "noisy tie",        2,  0.0 },
+    { "noisy vs steady",  2, 100.0 },                   /* Either receiver will do, SCORED prefers RX2. */
+    { "noisy gap",        2, 10.0 },
+    { "clean step",       1,  2.0 },
+    { "clean fades",     14,  3.0 },
+    { "noisy fades",     16,  6.0 },
+    { "dropouts",        24, 20.0 },
+};
+
+const int Policies[] = { POLICY_LEVEL, POLICY_SCORED };
+const char *PolicyName[] = { "LEVEL", "SCORED" };
+
+struct Result
+{
+    unsigned long Switches;
+    double Weaker;                                      /* % of the counted time. */
+    int Hysteresis;                                     /* Largest DiversityHysteresis seen, %. */
+    unsigned long Interval;                             /* Largest DiversityIntervalMillis seen. */
+};
+
+int Current;
+double Mean[2];                                         /* Signal before noise, updated every pass. */
+int Noise[2];
+unsigned int Seed = 1;
+
+int Random(int Spread)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return (int)((Seed >> 16) % ((2 * Spread) + 1)) - Spread;
+}
+
+void Signals(void)
+{
+    double Seconds = HostMicros / 1e6;
+    double Fade = 150 * sin(2 * M_PI * 0.5 * Seconds);
+
+    switch(Current)
+    {
+        case 0: Mean[0] = 700; Mean[1] = 700; Noise[0] = 3; Noise[1] = 3; break;
+        case 1: Mean[0] = 700; Mean[1] = 700; Noise[0] = 40; Noise[1] = 40; break;
+        case 2: Mean[0] = 800; Mean[1] = 790; Noise[0] = 35; Noise[1] = 4; break;
+        case 3: Mean[0] = 760; Mean[1] = 700; Noise[0] = 40; Noise[1] = 40; break;
+        case 4: Mean[0] = (Seconds < 4) ? 800 : 500; Mean[1] = 700; Noise[0] = 3; Noise[1] = 3; break;
+        case 5: Mean[0] = 750 + Fade; Mean[1] = 750 - Fade; Noise[0] = 3; Noise[1] = 3; break;
+        case 6: Mean[0] = 750 + Fade; Mean[1] = 750 - Fade; Noise[0] = 40; Noise[1] = 40; break;
+        default: Mean[0] = (fmod(Seconds, 1.1) < 0.04) ? 300 : 800; Mean[1] = 700; Noise[0] = 10; Noise[1] = 10; break;
+    }
+}
+
+int TraceADC(int Channel)
+{
+    if(Channel < 2)
+    {
+        return constrain((int)Mean[Channel] + Random(Noise[Channel]), 0, 1023);
+    }
+
+    return HostADCValue[Channel];
+}
+
+Result Run(int Policy)
+{
+    HostADC = TraceADC;
+    HostPin[MODE_SWITCH] = HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    MCUSR = _BV(BORF);                                  /* Skip the boot show. */
+    Signals();
+    setup();
+    ModeSwitchCounter = 3;                              /* Diversity. */
+    DiversityPolicy = Policy;
+
+    Result Done = { 0, 0, 0, 0 };
+    int Selected = RxControlPinState;
+    unsigned long Counted = 0;
+    unsigned long Weaker = 0;
+
+    while(HostMicros < RUN_SECONDS * 1000000UL)
+    {
+        Signals();
+        loop();
+        HostMicros += PASS_MICROS;
+
+        if(HostMicros < SETTLE_MICROS)
+        {
+            Selected = RxControlPinState;
+            continue;
+        }
+
+        int On = (RxControlPinState == LOW) ? 0 : 1;
+
+        Done.Switches += (RxControlPinState != Selected);
+        Selected = RxControlPinState;
+        Done.Hysteresis = (DiversityHysteresis > Done.Hysteresis) ? DiversityHysteresis : Done.Hysteresis;
+        Done.Interval = (DiversityIntervalMillis > Done.Interval) ? DiversityIntervalMillis : Done.Interval;
+        Counted++;
+        Weaker += (Mean[1 - On] - Mean[On] > WEAKER_MARGIN);
+    }
+
+    Done.Weaker = 100.0 * Weaker / Counted;
+    return Done;
+}
+
+int main(void)
+{
+    int Failed = 0;
+
+    printf("%-16s %-7s %8s %6s %9s %6s %7s %9s\n", "trace", "policy", "switches", "limit", "weaker", "limit",
+        "hyst %", "dwell ms");
+
+    for(Current = 0; Current < (int)(sizeof(Traces) / sizeof(Traces[0])); Current++)
+    {
+        for(int Policy = 0; Policy < (int)(sizeof(Policies) / sizeof(Policies[0])); Policy++)
+        {
+            int Pipe[2];
+            Result Done;
+
+            if(pipe(Pipe) != 0)
+            {
+                perror("pipe");
+                return 1;
+            }
+
+            fflush(stdout);
+
+            if(fork() == 0)
+            {
+                Done = Run(Policies[Policy]);
+                _exit(write(Pipe[1], &Done, sizeof(Done)) != sizeof(Done));
+            }
+
+            close(Pipe[1]);
+
+            if(read(Pipe[0], &Done, sizeof(Done)) != sizeof(Done))
+            {
+                fprintf(stderr, "%s %s: no result\n", Traces[Current].Name, PolicyName[Policy]);
+                return 1;
+            }
+
+            close(Pipe[0]);
+            wait(0);
+
+            bool Over = Done.Switches > Traces[Current].MaxSwitches || Done.Weaker > Traces[Current].MaxWeaker;
+
+            printf("%-16s %-7s %8lu %6lu %8.1f%% %5.0f%% %7d %9lu  %s\n", Traces[Current].Name, PolicyName[Policy],
+                Done.Switches, Traces[Current].MaxSwitches, Done.Weaker, Traces[Current].MaxWeaker,
+                Done.Hysteresis, Done.Interval, Over ? "FAIL" : "PASS");
+            Failed += Over;
+        }
+    }
+
+    printf("%d of %d runs over their limits\n", Failed,
+        (int)((sizeof(Traces) / sizeof(Traces[0])) * (sizeof(Policies) / sizeof(Policies[0]))));
+
+    return Failed != 0;
+}
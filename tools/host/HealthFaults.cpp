@@ -0,0 +1,223 @@
+/*******************************************************************************
+ HealthFaults - Fault injection tests for the receiver health monitor.
+
+    tools/host/build.sh tools/host/HealthFaults.cpp build/HealthFaults && build/HealthFaults
+
+Runs the sketch in diversity mode with RX1 the stronger, selected receiver.
+After FAULT_AT_MILLIS the scenario's fault is applied to RX1 and the run goes
+on to RUN_MILLIS. Each scenario checks the fault HealthCheck() reports for each
+receiver and which receiver is feeding the video at the end. Healthy scenarios,
+including fast Rayleigh fading and a signal pinned at full scale, must raise
+no fault at all. Exits non-zero if any scenario fails.
+
+The ADC sees each conversion in the order the sketch makes them, so a floating
+input picks up what was last on the ADC sample capacitor, as on the ATmega.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Sketch.cpp"
+
+#define FAULT_AT_MILLIS 2000
+#define RUN_MILLIS 8000
+#define PASS_MICROS 500                                 /* Loop time spent away from the ADC, added to every pass. */
+#define FADE_PATHS 16                                   /* Sum of sinusoids Rayleigh fading model. */
+#define FADE_STEPS_PER_DB 8                             /* RSSI ADC steps per dB, RX5808 on the 1V1 reference. */
+#define FLOAT_SHARE 0.4                                 /* Share of a floating input's charge taken from the ADC sample capacitor per conversion. */
+#define FLOAT_HUM 150                                   /* 50Hz hum picked up by a floating input, ADC steps. */
+#define FLOAT_PICKUP 10                                 /* Random pick up on a floating input, ADC steps. */
+
+enum Signal { STEADY, STUCK, RAIL, FLOATING, FULL_SCALE, RAYLEIGH };
+
+struct Receiver
+{
+    Signal Before;                                      /* Up to FAULT_AT_MILLIS. */
+    Signal After;
+    int Level;                                          /* Mean ADC reading. */
+    double Doppler;                                     /* Hz, for RAYLEIGH. */
+    double Angle[FADE_PATHS];
+    double Phase[FADE_PATHS];
+    int StuckAt;
+    double Charge;                                      /* Floating input voltage, ADC steps. */
+};
+
+struct Scenario
+{
+    const char *Name;
+    Receiver Rx[2];
+    int Fault[2];                                       /* Expected HealthFault[] at the end. */
+    int Selected;                                       /* Expected RxControlPinState at the end, -1 for either. */
+};
+
+Receiver Model[2];
+unsigned int Seed = 1;
+
+double Uniform(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return ((Seed >> 8) & 0xFFFF) / 65536.0;
+}
+
+double Gaussian(void)
+{
+    return sqrt(-2 * log(Uniform() + 1e-9)) * cos(2 * M_PI * Uniform());
+}
+
+int Reading(int Rx)
+{
+    Receiver &Model1 = Model[Rx];
+    Signal Now = (millis() < FAULT_AT_MILLIS) ? Model1.Before : Model1.After;
+    double Seconds = HostMicros / 1e6;
+
+    switch(Now)
+    {
+        case STEADY:
+            return Model1.Level + (int)(Gaussian() * 3);
+
+        case STUCK:
+            if(Model1.StuckAt < 0)
+            {
+                Model1.StuckAt = Model1.Level;
+            }
+
+            return Model1.StuckAt;
+
+        case RAIL:
+            return 8 + (int)(Uniform() * 4);
+
+        case FLOATING:                                  /* Shares charge with whatever the last conversion left, plus hum and pick up. */
+            Model1.Charge += FLOAT_SHARE * (HostLastConversion - Model1.Charge);
+            return (int)(Model1.Charge + (FLOAT_HUM * sin(2 * M_PI * 50 * Seconds)) + (Gaussian() * FLOAT_PICKUP));
+
+        case FULL_SCALE:
+            return 1023;
+
+        case RAYLEIGH:
+        {
+            double Real = 0;
+            double Imaginary = 0;
+
+            for(int Path = 0; Path < FADE_PATHS; Path++)
+            {
+                double Theta = (2 * M_PI * Model1.Doppler * cos(Model1.Angle[Path]) * Seconds) + Model1.Phase[Path];
+                Real += cos(Theta);
+                Imaginary += sin(Theta);
+            }
+
+            double Power = (Real * Real + Imaginary * Imaginary) / FADE_PATHS;
+            return Model1.Level + (int)(FADE_STEPS_PER_DB * 10 * log10(Power + 1e-6)) + (int)(Gaussian() * 3);
+        }
+    }
+
+    return 0;
+}
+
+int ScenarioADC(int Channel)
+{
+    if(Channel == 0 || Channel == 1)
+    {
+        return Reading(Channel);
+    }
+
+    return HostADCValue[Channel];
+}
+
+/* Runs in its own process so every scenario starts from a fresh sketch. */
+int Run(const Scenario &Test)
+{
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        Model[Rx] = Test.Rx[Rx];
+        Model[Rx].StuckAt = -1;
+        Model[Rx].Charge = Model[Rx].Level;
+
+        for(int Path = 0; Path < FADE_PATHS; Path++)
+        {
+            Model[Rx].Angle[Path] = 2 * M_PI * Uniform();
+            Model[Rx].Phase[Path] = 2 * M_PI * Uniform();
+        }
+    }
+
+    HostADC = ScenarioADC;
+    HostPin[MODE_SWITCH] = HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    setup();
+    ModeSwitchCounter = 3;
+
+    unsigned long FalseFaults = 0;
+    unsigned long Passes = 0;
+    long SwitchAway = -1;
+
+    while(millis() < RUN_MILLIS)
+    {
+        loop();
+        HostMicros += PASS_MICROS;
+        Passes++;
+
+        for(int Rx = 0; Rx < 2; Rx++)
+        {
+            FalseFaults += (Test.Fault[Rx] == HEALTH_OK && HealthFault[Rx] != HEALTH_OK);
+        }
+
+        if(SwitchAway < 0 && millis() >= FAULT_AT_MILLIS && RxControlPinState == HIGH)
+        {
+            SwitchAway = millis() - FAULT_AT_MILLIS;
+        }
+    }
+
+    bool Pass = FalseFaults == 0 && HealthFault[0] == Test.Fault[0] && HealthFault[1] == Test.Fault[1]
+        && (Test.Selected < 0 || RxControlPinState == Test.Selected);
+
+    printf("%-28s %s  fault %d/%d (want %d/%d)  RX%d  false-fault passes %lu/%lu", Test.Name, Pass ? "PASS" : "FAIL",
+        HealthFault[0], HealthFault[1], Test.Fault[0], Test.Fault[1], RxControlPinState + 1, FalseFaults, Passes);
+
+    if(Test.Fault[0] != HEALTH_OK && SwitchAway >= 0)
+    {
+        printf("  RX2 after %ld ms", SwitchAway);
+    }
+
+    printf("\n");
+    fflush(stdout);
+    return Pass ? 0 : 1;
+}
+
+int main(void)
+{
+    const Receiver Good1 = { STEADY, STEADY, 800 };
+    const Receiver Good2 = { STEADY, STEADY, 700 };
+
+    Scenario Tests[] =
+    {
+        { "healthy",                   { Good1, Good2 },                                            { HEALTH_OK, HEALTH_OK },       LOW },
+        { "stuck",                     { { STEADY, STUCK, 800 }, Good2 },                           { HEALTH_STUCK, HEALTH_OK },    HIGH },
+        { "rail",                      { { STEADY, RAIL, 800 }, Good2 },                            { HEALTH_RAIL, HEALTH_OK },     HIGH },
+        { "floating",                  { { STEADY, FLOATING, 800 }, Good2 },                        { HEALTH_FLOATING, HEALTH_OK },    HIGH },
+        { "floating, RX2 fading",      { { STEADY, FLOATING, 800 }, { RAYLEIGH, RAYLEIGH, 700, 300 } }, { HEALTH_FLOATING, HEALTH_OK }, HIGH },
+        { "full scale",                { { FULL_SCALE, FULL_SCALE, 1023 }, Good2 },                 { HEALTH_OK, HEALTH_OK },       LOW },
+        { "Rayleigh 50Hz",             { { RAYLEIGH, RAYLEIGH, 800, 50 }, { RAYLEIGH, RAYLEIGH, 780, 50 } },   { HEALTH_OK, HEALTH_OK }, -1 },
+        { "Rayleigh 100Hz",            { { RAYLEIGH, RAYLEIGH, 800, 100 }, { RAYLEIGH, RAYLEIGH, 780, 100 } }, { HEALTH_OK, HEALTH_OK }, -1 },
+        { "Rayleigh 300Hz",            { { RAYLEIGH, RAYLEIGH, 800, 300 }, { RAYLEIGH, RAYLEIGH, 780, 300 } }, { HEALTH_OK, HEALTH_OK }, -1 },
+        { "Rayleigh 600Hz",            { { RAYLEIGH, RAYLEIGH, 800, 600 }, { RAYLEIGH, RAYLEIGH, 780, 600 } }, { HEALTH_OK, HEALTH_OK }, -1 },
+    };
+
+    int Failed = 0;
+    int Count = sizeof(Tests) / sizeof(Tests[0]);
+
+    for(int Test = 0; Test < Count; Test++)
+    {
+        fflush(stdout);
+
+        if(fork() == 0)
+        {
+            Seed = 1 + Test;
+            _exit(Run(Tests[Test]));
+        }
+
+        int Status;
+        wait(&Status);
+        Failed += (WIFEXITED(Status) == 0 || WEXITSTATUS(Status) != 0);
+    }
+
+    printf("%d of %d scenarios failed\n", Failed, Count);
+    return Failed > 0;
+}
@@ -0,0 +1,416 @@
+/*******************************************************************************
+ InjectReplay - Play a trace in through trace injection, diff the switches.
+
+    tools/host/build.sh tools/host/InjectReplay.cpp build/InjectReplay -DBUILD_PROFILE=PROFILE_BENCH
+    build/InjectReplay [trace.d4rt]
+
+Acts as the bench host of TRACE INJECTION. Powers up, sends "D4RI" and feeds
+the trace's blocks as they are, two in flight and another on each INJECT_ACK,
+from HostTick so the sketch is fed whilst it waits inside a pass. Collects the
+INJECT_SWITCH messages sent back. Then powers up again and reads the same
+samples through the ADC, one per pass, and diffs the switches of the two runs.
+Both runs give each pass the trace's sample interval of virtual time and use
+the trace's calibration, so they should agree to within a few samples; a
+switch in one run without one in the other, within DIFF_SAMPLES, is a
+difference.
+
+After the last block the host goes quiet, and the sketch must go back to the
+receivers within INJECT_TIMEOUT_MILLIS, finishing first any bandgap check the
+injection held up. Exits non-zero on any difference, a NAK, or a missed
+timeout.
+
+Without a trace, a synthetic one of crossing fades with noise and dropouts is
+written next to the program, as <program>.d4rt, and played.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Sketch.cpp"
+#include "../trace/RSSITrace.h"
+
+#define DIFF_SAMPLES 3                                  /* Switches this close count as the same. */
+#define SYNTHETIC_SECONDS 30
+
+struct Switch
+{
+    unsigned long Sample;                               /* Samples used before the switch, as INJECT_SWITCH. */
+    int State;                                          /* New RxControlPinState. */
+};
+
+RSSITrace Trace;
+std::vector<uint16_t> Samples[2];
+unsigned long PassMicros;
+
+/* Injected run, the host's side. */
+size_t NextBlock = 0;
+size_t OutRead = 0;
+bool Talking = false;                                   /* "D4RI" answered. */
+bool Quiet = false;                                     /* Host gone quiet after the last block. */
+unsigned long Naks = 0;
+std::vector<Switch> Switches;
+
+/* Direct run. */
+size_t DirectPass = 0;
+
+void SendBlock(void)
+{
+    if(NextBlock < Trace.Index().size())
+    {
+        const uint8_t *Bytes = Trace.BlockData(NextBlock);
+        size_t Length = RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Bytes[1] - 1)) + 1;
+
+        HostSerialIn.insert(HostSerialIn.end(), Bytes, Bytes + Length);
+        NextBlock++;
+    }
+}
+
+unsigned long Little(size_t At, int Count)
+{
+    unsigned long Value = 0;
+
+    for(int Byte = Count - 1; Byte >= 0; Byte--)
+    {
+        Value = (Value << 8) | HostSerialOut[At + Byte];
+    }
+
+    return Value;
+}
+
+/* Reads what the sketch has sent back, as the host would. */
+void Host(void)
+{
+    while(OutRead < HostSerialOut.size())
+    {
+        size_t Left = HostSerialOut.size() - OutRead;
+        uint8_t Type = HostSerialOut[OutRead];
+
+        if(Talking == false)
+        {
+            if(Left < 4)
+            {
+                return;
+            }
+
+            if(memcmp(&HostSerialOut[OutRead], "D4RI", 4) == 0)
+            {
+                Talking = true;
+                OutRead += 4;
+                SendBlock();
+                SendBlock();
+            }
+
+            else
+            {
+                OutRead++;
+            }
+        }
+
+        else if(Type == INJECT_ACK || Type == INJECT_NAK)
+        {
+            if(Left < 3)
+            {
+                return;
+            }
+
+            Naks += (Type == INJECT_NAK);
+            OutRead += 3;
+
+            if(Quiet == false)
+            {
+                SendBlock();
+            }
+        }
+
+        else if(Type == INJECT_SWITCH)
+        {
+            if(Left < 10)
+            {
+                return;
+            }
+
+            Switch Made = { Little(OutRead + 1, 4), HostSerialOut[OutRead + 9] };
+
+            Switches.push_back(Made);
+            OutRead += 10;
+        }
+
+        else
+        {
+            printf("unexpected byte 0x%02X from the sketch\n", Type);
+            exit(1);
+        }
+    }
+}
+
+int DirectADC(int Channel)
+{
+    if(Channel < 2)
+    {
+        return Samples[Channel][(DirectPass < Samples[Channel].size()) ? DirectPass : Samples[Channel].size() - 1];
+    }
+
+    return HostADCValue[Channel];
+}
+
+int QuietADC(int Channel)
+{
+    return (Channel < 2) ? 700 : HostADCValue[Channel];
+}
+
+void PowerUp(void)
+{
+    HostPin[MODE_SWITCH] = HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    MCUSR = _BV(BORF);                                  /* Skip the boot show. */
+    setup();
+    ModeSwitchCounter = 3;                              /* Diversity. */
+
+    if(Trace.Info().RSSI1Max > Trace.Info().RSSI1Min && Trace.Info().RSSI2Max > Trace.Info().RSSI2Min)
+    {
+        RSSI1Min = Trace.Info().RSSI1Min;
+        RSSI1Max = Trace.Info().RSSI1Max;
+        RSSI2Min = Trace.Info().RSSI2Min;
+        RSSI2Max = Trace.Info().RSSI2Max;
+    }
+}
+
+/* Gives the pass the rest of its sample interval. */
+void Pace(unsigned long Start)
+{
+    if(HostMicros - Start < PassMicros)
+    {
+        HostMicros = Start + PassMicros;
+    }
+}
+
+/* Injected run, writes its switches and a pass / fail to Out. */
+void Injected(int Out)
+{
+    HostADC = QuietADC;
+    HostTick = Host;
+    PowerUp();
+    HostSerialIn.insert(HostSerialIn.end(), "D4RI", "D4RI" + 4);
+
+    while(InjectMode == false && HostMicros < 1000000)
+    {
+        loop();
+    }
+
+    if(InjectMode == false)
+    {
+        printf("injection never started\n");
+        _exit(1);
+    }
+
+    while(InjectSampleCount < Samples[0].size())
+    {
+        unsigned long Start = HostMicros;
+
+        loop();
+        Pace(Start);
+    }
+
+    /* Host goes quiet, the next pass should wait INJECT_TIMEOUT_MILLIS and then read the ADC, once any bandgap
+       check the injection held up has let AREF settle. */
+    Quiet = true;
+    unsigned long QuietStart = HostMicros;
+    unsigned long ConversionsBefore = HostConversions;
+
+    for(int Wait = 0; Wait < 1000 && (InjectMode == true || HostConversions == ConversionsBefore); Wait++)
+    {
+        loop();
+    }
+
+    unsigned long Waited = (HostMicros - QuietStart) / 1000;
+    bool TimedOut = (InjectMode == false) && (HostConversions > ConversionsBefore) && (Waited <= INJECT_TIMEOUT_MILLIS + 50);
+    unsigned long Count = Switches.size();
+
+    printf("host quiet      %s, live ADC after %lu ms (INJECT_TIMEOUT_MILLIS %d)\n",
+        TimedOut ? "PASS" : "FAIL", Waited, INJECT_TIMEOUT_MILLIS);
+    printf("checksums       %s, NAKs %lu\n", (Naks == 0) ? "PASS" : "FAIL", Naks);
+    fflush(stdout);
+
+    bool Passed = TimedOut && Naks == 0;
+
+    if(write(Out, &Passed, sizeof(Passed)) != sizeof(Passed) || write(Out, &Count, sizeof(Count)) != sizeof(Count)
+        || write(Out, Switches.data(), Count * sizeof(Switch)) != (ssize_t)(Count * sizeof(Switch)))
+    {
+        _exit(1);
+    }
+
+    _exit(0);
+}
+
+/* Direct run, the same samples through the ADC. */
+void Direct(int Out)
+{
+    HostADC = DirectADC;
+    PowerUp();
+
+    int Selected = RxControlPinState;
+
+    for(DirectPass = 0; DirectPass < Samples[0].size(); DirectPass++)
+    {
+        unsigned long Start = HostMicros;
+
+        loop();
+        Pace(Start);
+
+        if(RxControlPinState != Selected)
+        {
+            Switch Made = { (unsigned long)DirectPass + 1, RxControlPinState };
+
+            Switches.push_back(Made);
+            Selected = RxControlPinState;
+        }
+    }
+
+    bool Passed = true;
+    unsigned long Count = Switches.size();
+
+    if(write(Out, &Passed, sizeof(Passed)) != sizeof(Passed) || write(Out, &Count, sizeof(Count)) != sizeof(Count)
+        || write(Out, Switches.data(), Count * sizeof(Switch)) != (ssize_t)(Count * sizeof(Switch)))
+    {
+        _exit(1);
+    }
+
+    _exit(0);
+}
+
+bool Run(void (*Body)(int Out), std::vector<Switch> &Made)
+{
+    int Pipe[2];
+    bool Passed = false;
+    unsigned long Count = 0;
+
+    if(pipe(Pipe) != 0)
+    {
+        perror("pipe");
+        exit(1);
+    }
+
+    fflush(stdout);
+
+    if(fork() == 0)
+    {
+        close(Pipe[0]);
+        Body(Pipe[1]);
+    }
+
+    close(Pipe[1]);
+
+    if(read(Pipe[0], &Passed, sizeof(Passed)) != sizeof(Passed) || read(Pipe[0], &Count, sizeof(Count)) != sizeof(Count))
+    {
+        printf("run failed\n");
+        exit(1);
+    }
+
+    Made.resize(Count);
+
+    if(Count > 0 && read(Pipe[0], Made.data(), Count * sizeof(Switch)) != (ssize_t)(Count * sizeof(Switch)))
+    {
+        printf("run failed\n");
+        exit(1);
+    }
+
+    close(Pipe[0]);
+    wait(0);
+    return Passed;
+}
+
+/* Switches in From with no switch to the same receiver in To within DIFF_SAMPLES. */
+unsigned long Unmatched(const std::vector<Switch> &From, const std::vector<Switch> &To, const char *Label)
+{
+    unsigned long Count = 0;
+
+    for(size_t Index = 0; Index < From.size(); Index++)
+    {
+        bool Found = false;
+
+        for(size_t Other = 0; Other < To.size() && Found == false; Other++)
+        {
+            long Apart = (long)From[Index].Sample - (long)To[Other].Sample;
+
+            Found = (To[Other].State == From[Index].State) && Apart <= DIFF_SAMPLES && Apart >= -DIFF_SAMPLES;
+        }
+
+        if(Found == false)
+        {
+            printf("  %s sample %lu to RX%d\n", Label, From[Index].Sample, From[Index].State + 1);
+            Count++;
+        }
+    }
+
+    return Count;
+}
+
+void Synthetic(const std::string &Path)
+{
+    RSSITraceHeader Info = { RSSI_TRACE_VERSION, 5, 512, 1023, 512, 1023, 1100 };
+    RSSITraceWriter Writer;
+    unsigned int Seed = 1;
+
+    if(Writer.Open(Path, Info) == false)
+    {
+        printf("can't write %s\n", Path.c_str());
+        exit(1);
+    }
+
+    for(unsigned long Sample = 0; Sample < SYNTHETIC_SECONDS * 1000UL / Info.IntervalMillis; Sample++)
+    {
+        double Seconds = Sample * Info.IntervalMillis / 1000.0;
+        int Noise1 = (int)((Seed = Seed * 1103515245 + 12345) >> 16) % 31 - 15;
+        int Noise2 = (int)((Seed = Seed * 1103515245 + 12345) >> 16) % 11 - 5;
+        double Level1 = 800 + (150 * sin(Seconds * 1.3)) - ((fmod(Seconds, 2.3) < 0.04) ? 300 : 0);
+        double Level2 = 800 - (150 * sin(Seconds * 1.3));
+
+        Writer.Add(constrain((int)Level1 + Noise1, 0, 1023), constrain((int)Level2 + Noise2, 0, 1023), false);
+    }
+
+    Writer.Close();
+}
+
+int main(int argc, char **argv)
+{
+    std::string Path = (argc > 1) ? argv[1] : std::string(argv[0]) + ".d4rt";
+    RSSITraceCursor *Cursor;
+    RSSITraceSample Sample;
+
+    if(argc < 2)
+    {
+        Synthetic(Path);
+    }
+
+    if(Trace.Open(Path, false) == false)
+    {
+        printf("%s\n", Trace.LastError().c_str());
+        return 1;
+    }
+
+    Cursor = new RSSITraceCursor(Trace);
+
+    while(Cursor->Next(Sample) == true)
+    {
+        Samples[0].push_back(Sample.RSSI1);
+        Samples[1].push_back(Sample.RSSI2);
+    }
+
+    delete Cursor;
+    PassMicros = ((Trace.Info().IntervalMillis > 0) ? Trace.Info().IntervalMillis : 5) * 1000;
+    printf("%s: %lu samples in %lu blocks, %lu ms apart\n", Path.c_str(), (unsigned long)Samples[0].size(),
+        (unsigned long)Trace.Index().size(), PassMicros / 1000);
+
+    std::vector<Switch> ByInjection;
+    std::vector<Switch> ByADC;
+    bool Passed = Run(Injected, ByInjection);
+
+    Run(Direct, ByADC);
+    printf("switches        %lu injected, %lu through the ADC\n", (unsigned long)ByInjection.size(), (unsigned long)ByADC.size());
+
+    unsigned long Differences = Unmatched(ByInjection, ByADC, "injected only") + Unmatched(ByADC, ByInjection, "ADC only");
+
+    printf("diff            %s, %lu switches differ by more than %d samples\n",
+        (Differences == 0) ? "PASS" : "FAIL", Differences, DIFF_SAMPLES);
+
+    return (Passed == true && Differences == 0) ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ LoopTime - Time passes through the loop, as LoopTiming() does, in any profile.
+
+    tools/host/build.sh tools/host/LoopTime.cpp build/LoopTime -DBUILD_PROFILE=PROFILE_RACE
+    build/LoopTime [seconds]
+
+Powers up without a button held (diversity, no debug text) and, if the
+profile has a serial port, again with the mode button held (serial debug mode).
+Runs the loop against two fading receivers and prints the mean and longest
+pass, timed start to start like LoopTiming(). Virtual time counts ADC
+conversions, delays, pin access and serial output at the port's baud rate,
+but no CPU time, so these are the floor of what the board will show, and
+close to it where the ADC and serial port dominate. Profiles that differ only
+in the code they run come out the same here; compare those on a board.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Sketch.cpp"
+
+int FadeADC(int Channel)
+{
+    double Seconds = HostMicros / 1e6;
+
+    if(Channel < 2)
+    {
+        return 700 + (int)(200 * sin(2 * M_PI * (0.5 + Channel * 0.3) * Seconds)) + (rand() % 7) - 3;
+    }
+
+    return HostADCValue[Channel];
+}
+
+void Run(bool Debug, unsigned long Seconds)
+{
+    HostADC = FadeADC;
+    HostPin[MODE_SWITCH] = Debug ? LOW : HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    setup();
+    HostPin[MODE_SWITCH] = HIGH;
+
+    unsigned long Previous = 0;
+    unsigned long Longest = 0;
+    unsigned long long Total = 0;
+    unsigned long Passes = 0;
+
+    while(HostMicros < 1000000)                         /* Boot show, banner and injection window out of the way. */
+    {
+        loop();
+    }
+
+    while(HostMicros < (Seconds + 1) * 1000000)
+    {
+        Previous = HostMicros;
+        loop();
+        Total += HostMicros - Previous;
+        Longest = (HostMicros - Previous > Longest) ? HostMicros - Previous : Longest;
+        Passes++;
+    }
+
+    printf("%-8s %-6s %8.0f %8lu %8lu\n", BUILD_PROFILE_NAME, Debug ? "debug" : "normal",
+        (double)Total / Passes, Longest, Passes);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long Seconds = (argc > 1) ? strtoul(argv[1], 0, 0) : 10;
+
+    for(int Debug = 0; Debug < ((FEATURE_SERIAL == true) ? 2 : 1); Debug++)
+    {
+        if(fork() == 0)
+        {
+            Run(Debug == 1, Seconds);
+            _exit(0);
+        }
+
+        wait(0);
+    }
+
+    return 0;
+}
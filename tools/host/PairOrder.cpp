@@ -0,0 +1,171 @@
+/*******************************************************************************
+ PairOrder - Skew between the two receivers' readings, A-B-B-A against in turn.
+
+    tools/host/build.sh tools/host/PairOrder.cpp build/PairOrder && build/PairOrder
+
+Both receivers fade as sines 200 ADC steps either side of 600, a quarter turn
+apart, at fade rates up to the 600Hz of fast 5.8GHz multipath. Reads them
+PAIRS times at each ADC clock, through RSSIConvert() as RSSIPairRead() does:
+
+  A-B-B-A   RX1 (RX2) RX2 RX2 (RX1) RX1, each pair of readings averaged.
+  in turn   (RX1) RX1 (RX2) RX2, the order before RSSIPairRead().
+
+and prints the RMS and worst error of RX1 - RX2, in ADC steps, against the
+true difference at the middle of the readings used. Every conversion takes
+13 ADC clocks of virtual time and returns the signal at its start, so this
+only measures the timing. What the ADC loses in accuracy above 200kHz, the
+datasheet limit for full 10 bit results, doesn't show on a PC. The last line
+checks RSSIPairRead() itself, at RSSI_ADC_PRESCALER, reads as the A-B-B-A row
+at the same clock does.
+*******************************************************************************/
+
+#include "Sketch.cpp"
+
+#define PAIRS 2000
+#define GAP_MICROS 1237                                 /* Between pairs, not a multiple of any fade period. */
+
+const double FadeHz[] = { 50, 150, 300, 600 };
+const int Prescaler[] = { _BV(ADPS2) | _BV(ADPS0), _BV(ADPS2) | _BV(ADPS1), _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0) };
+const char *PrescalerName[] = { "/32 500kHz", "/64 250kHz", "/128 125kHz" };
+
+double Hz;
+double Taken[2];                                        /* Sum of the times each receiver was read at. */
+
+double Signal(int Channel, double Micros)
+{
+    return 600 + (200 * sin((2 * M_PI * Hz * Micros / 1e6) + (Channel * M_PI / 2)));
+}
+
+int FadeADC(int Channel)
+{
+    if(Channel < 2)
+    {
+        return (int)floor(Signal(Channel, HostMicros) + 0.5);
+    }
+
+    return HostADCValue[Channel];
+}
+
+/* Keeps a reading, and the time it was taken at. */
+unsigned int Keep(int Channel, unsigned int Value, unsigned long Micros)
+{
+    Taken[Channel] += Micros;
+    return Value;
+}
+
+/* One read of both receivers, returns the error of RX1 - RX2 against the truth. */
+double Read(int Order, int Clock)
+{
+    byte ADCSRASaved = ADCSRA;
+    int RX1 = RSSI1_ADC_PIN - A0;
+    int RX2 = RSSI2_ADC_PIN - A0;
+    double Value[2];
+    unsigned long Start;
+
+    Taken[0] = 0;
+    Taken[1] = 0;
+    ADCSRA = (ADCSRA & ~(_BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0))) | Clock;
+    ADMUX = (ADMUX & 0xF0) | RX1;
+
+    if(Order == 0)
+    {
+        Start = HostMicros;
+        Value[0] = Keep(RX1, RSSIConvert(RSSI2_ADC_PIN), Start);
+        RSSIConvert(RSSI2_ADC_PIN);
+        Start = HostMicros;
+        Value[1] = Keep(RX2, RSSIConvert(RSSI2_ADC_PIN), Start);
+        Start = HostMicros;
+        Value[1] += Keep(RX2, RSSIConvert(RSSI1_ADC_PIN), Start);
+        RSSIConvert(RSSI1_ADC_PIN);
+        Start = HostMicros;
+        Value[0] += Keep(RX1, RSSIConvert(RSSI1_ADC_PIN), Start);
+        Value[0] /= 2;
+        Value[1] /= 2;
+        Taken[0] /= 2;
+        Taken[1] /= 2;
+    }
+
+    else if(Order == 1)
+    {
+        RSSIConvert(RSSI1_ADC_PIN);
+        Start = HostMicros;
+        Value[0] = Keep(RX1, RSSIConvert(RSSI2_ADC_PIN), Start);
+        RSSIConvert(RSSI2_ADC_PIN);
+        Start = HostMicros;
+        Value[1] = Keep(RX2, RSSIConvert(RSSI1_ADC_PIN), Start);
+    }
+
+    else
+    {
+        unsigned long Before = HostConversions;
+
+        RSSIPairRead();
+
+        if(HostConversions - Before != 6)
+        {
+            printf("RSSIPairRead() made %lu conversions, not 6\n", HostConversions - Before);
+            exit(1);
+        }
+
+        return 0;
+    }
+
+    ADCSRA = ADCSRASaved;
+
+    double Middle = (Taken[0] + Taken[1]) / 2;
+
+    return (Value[0] - Value[1]) - (Signal(RX1, Middle) - Signal(RX2, Middle));
+}
+
+int main(void)
+{
+    const char *OrderName[] = { "A-B-B-A", "in turn" };
+
+    HostADC = FadeADC;
+    printf("%-12s %-8s %12s %12s %12s %12s\n", "ADC clock", "order", "50Hz", "150Hz", "300Hz", "600Hz");
+
+    for(int Clock = 0; Clock < 3; Clock++)
+    {
+        for(int Order = 0; Order < 2; Order++)
+        {
+            printf("%-12s %-8s", PrescalerName[Clock], OrderName[Order]);
+
+            for(size_t Fade = 0; Fade < sizeof(FadeHz) / sizeof(FadeHz[0]); Fade++)
+            {
+                double Squares = 0;
+                double Worst = 0;
+
+                Hz = FadeHz[Fade];
+
+                for(int Pair = 0; Pair < PAIRS; Pair++)
+                {
+                    double Error = Read(Order, Prescaler[Clock]);
+
+                    Squares += Error * Error;
+                    Worst = (fabs(Error) > Worst) ? fabs(Error) : Worst;
+                    HostMicros += GAP_MICROS;
+                }
+
+                printf(" %5.1f / %4.0f", sqrt(Squares / PAIRS), Worst);
+            }
+
+            printf("\n");
+        }
+    }
+
+    /* RSSIPairRead() against the A-B-B-A row at RSSI_ADC_PRESCALER. */
+    Hz = FadeHz[3];
+    HostMicros = 0;
+    Read(2, 0);
+    unsigned long Sketch = HostMicros;
+    double SketchError = ((double)RSSI1InputPinValue - RSSI2InputPinValue);
+    HostMicros = 0;
+    double Error = Read(0, RSSI_ADC_PRESCALER);
+    double Mine = Error + (Signal(0, (Taken[0] + Taken[1]) / 2) - Signal(1, (Taken[0] + Taken[1]) / 2));
+    bool Same = (fabs(SketchError - Mine) <= 1) && (Sketch == HostMicros);
+
+    printf("RSSIPairRead() %s the A-B-B-A row at RSSI_ADC_PRESCALER, %luus per pair\n",
+        Same ? "matches" : "DIFFERS FROM", Sketch);
+
+    return Same ? 0 : 1;
+}
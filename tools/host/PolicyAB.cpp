@@ -0,0 +1,236 @@
+/*******************************************************************************
+ PolicyAB - Compare the diversity policies on the same receiver signals.
+
+    tools/host/build.sh tools/host/PolicyAB.cpp build/PolicyAB && build/PolicyAB [seconds]
+
+Powers up, selects diversity and runs every policy, then the spectrum analyser
+with the policy it uses, through each scenario for the given seconds of
+virtual time (default 6), with the same noise seed for every policy:
+
+  slow fade        RX1 fades from 900 to 600 over 2 s, RX2 steady at 750.
+  noisy vs steady  RX1 at 800 with +-35 of noise, RX2 at 790 with +-4.
+  noisy tie        both receivers at 800 with +-30 of noise.
+  crossing fades   the receivers cross 120 either side of 800 at 2 rad/s,
+                   RX1 noisier and dropping 250 for 30 ms every 0.7 s.
+
+The better receiver is the one with the higher signal before noise, or RX2
+when noisy vs steady. Prints, for each run, the switches, the time on the
+better receiver and the mean RSSI given up to the other one, in % of full
+scale, from 0.5 s on. On noisy vs steady and noisy tie nothing changes but
+the noise, so a switch that doesn't land on the better receiver, and any
+switch on the tie, is thrash. Fails if a policy thrashes more than
+POLICY_LEVEL. A single move onto the better receiver isn't counted: SCORED
+prefers RX2 on noisy vs steady by about its hysteresis, so whether it gets
+there within the run depends on the noise seed. The throughput is the host CPU time per loop pass, the
+same work for every policy bar the policy itself. Each run is repeated ROUNDS
+times, every policy in turn, and the median is kept, so that the PC speeding
+up or slowing down over time is shared out between the policies.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "Sketch.cpp"
+
+#define PASS_MICROS 300                                 /* Loop time spent away from the ADC, added to every pass. */
+#define SETTLE_MICROS 500000                            /* Not counted, the averages filling. */
+#define ROUNDS 5
+#define SPECTRUM 3                                      /* Run index past the policies, spectrum analyser shown. */
+
+const char *ScenarioName[] = { "slow fade", "noisy vs steady", "crossing fades", "noisy tie" };
+const bool ScenarioStatic[] = { false, true, false, true };
+const char *PolicyName[] = { "LEVEL", "SCORED", "FREEZE", "spectrum" };
+
+struct Result
+{
+    unsigned long Switches;
+    unsigned long Thrash;                               /* Switches not onto the better receiver, static scenarios. */
+    double OnBetter;                                    /* % of the time. */
+    double Deficit;                                     /* % of full scale. */
+    double Nanos;                                       /* Host CPU time per pass. */
+};
+
+int Scenario;
+double Mean[2];                                         /* Signal before noise, updated every pass. */
+int Noise[2];
+
+void Signals(void)
+{
+    double Seconds = HostMicros / 1e6;
+
+    if(Scenario == 0)
+    {
+        Mean[0] = (Seconds < 1) ? 900 : ((Seconds < 3) ? 900 - (150 * (Seconds - 1)) : 600);
+        Mean[1] = 750;
+        Noise[0] = 8;
+        Noise[1] = 8;
+    }
+
+    else if(Scenario == 1)
+    {
+        Mean[0] = 800;
+        Mean[1] = 790;
+        Noise[0] = 35;
+        Noise[1] = 4;
+    }
+
+    else if(Scenario == 3)
+    {
+        Mean[0] = 800;
+        Mean[1] = 800;
+        Noise[0] = 30;
+        Noise[1] = 30;
+    }
+
+    else
+    {
+        Mean[0] = 800 + (120 * sin(Seconds * 2.0)) - ((fmod(Seconds, 0.7) < 0.03) ? 250 : 0);
+        Mean[1] = 800 - (120 * sin(Seconds * 2.0));
+        Noise[0] = 20;
+        Noise[1] = 6;
+    }
+}
+
+int PolicyADC(int Channel)
+{
+    if(Channel < 2)
+    {
+        return constrain((int)Mean[Channel] + (rand() % ((2 * Noise[Channel]) + 1)) - Noise[Channel], 0, 1023);
+    }
+
+    return HostADCValue[Channel];
+}
+
+Result Run(int Policy, unsigned long Seconds)
+{
+    srand(7);
+    HostADC = PolicyADC;
+    HostPin[MODE_SWITCH] = HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    MCUSR = _BV(BORF);                                  /* Skip the boot show. */
+    Signals();
+    setup();
+    ModeSwitchCounter = 3;
+    DiversityPolicy = (Policy == SPECTRUM) ? DIVERSITY_POLICY : Policy;
+    VideoSwitchCounter = (Policy == SPECTRUM) ? 2 : 1;
+
+    int Selected = RxControlPinState;
+    unsigned long Switches = 0;
+    unsigned long Thrash = 0;
+    unsigned long Counted = 0;
+    unsigned long OnBetter = 0;
+    unsigned long Passes = 0;
+    double Deficit = 0;
+    timespec Start, End;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &Start);
+
+    while(HostMicros < Seconds * 1000000)
+    {
+        Signals();
+        loop();
+        HostMicros += PASS_MICROS;
+        Passes++;
+
+        if(HostMicros < SETTLE_MICROS)
+        {
+            Selected = RxControlPinState;
+            continue;
+        }
+
+        int On = (RxControlPinState == LOW) ? 0 : 1;
+        int Better = (Scenario == 1) ? 1 : ((Mean[0] >= Mean[1]) ? 0 : 1);
+
+        if(RxControlPinState != Selected)
+        {
+            Switches++;
+            Thrash += ScenarioStatic[Scenario] && (On != Better || Mean[0] == Mean[1]);
+            Selected = RxControlPinState;
+        }
+
+        Counted++;
+        OnBetter += (On == Better) || (Mean[0] == Mean[1]);
+        Deficit += (Mean[1 - On] > Mean[On]) ? (Mean[1 - On] - Mean[On]) * 100.0 / 1023 : 0;
+    }
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &End);
+
+    Result Done = { Switches, Thrash, 100.0 * OnBetter / Counted, Deficit / Counted,
+        (((End.tv_sec - Start.tv_sec) * 1e9) + (End.tv_nsec - Start.tv_nsec)) / Passes };
+
+    return Done;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long Seconds = (argc > 1) ? strtoul(argv[1], 0, 0) : 6;
+    int Scenarios = sizeof(ScenarioName) / sizeof(ScenarioName[0]);
+
+    std::vector<Result> Results[sizeof(ScenarioName) / sizeof(ScenarioName[0])][SPECTRUM + 1];
+
+    for(int Round = 0; Round < ROUNDS; Round++)
+    {
+        for(Scenario = 0; Scenario < Scenarios; Scenario++)
+        {
+            for(int Policy = POLICY_LEVEL; Policy <= SPECTRUM; Policy++)
+            {
+                int Pipe[2];
+                Result Done;
+
+                if(pipe(Pipe) != 0)
+                {
+                    perror("pipe");
+                    return 1;
+                }
+
+                if(fork() == 0)
+                {
+                    Done = Run(Policy, Seconds);
+                    _exit(write(Pipe[1], &Done, sizeof(Done)) != sizeof(Done));
+                }
+
+                close(Pipe[1]);
+
+                if(read(Pipe[0], &Done, sizeof(Done)) != sizeof(Done))
+                {
+                    fprintf(stderr, "%s %s: no result\n", ScenarioName[Scenario], PolicyName[Policy]);
+                    return 1;
+                }
+
+                close(Pipe[0]);
+                wait(0);
+                Results[Scenario][Policy].push_back(Done);
+            }
+        }
+    }
+
+    int Failed = 0;
+
+    printf("%-16s %-8s %8s %9s %10s %9s\n", "scenario", "policy", "switches", "on better", "deficit", "ns/pass");
+
+    for(Scenario = 0; Scenario < Scenarios; Scenario++)
+    {
+        for(int Policy = POLICY_LEVEL; Policy <= SPECTRUM; Policy++)
+        {
+            std::vector<Result> &Runs = Results[Scenario][Policy];
+            std::vector<double> Nanos;
+
+            for(size_t Index = 0; Index < Runs.size(); Index++)
+            {
+                Nanos.push_back(Runs[Index].Nanos);
+            }
+
+            bool Thrash = Runs[0].Thrash > Results[Scenario][POLICY_LEVEL][0].Thrash;
+
+            std::sort(Nanos.begin(), Nanos.end());
+            printf("%-16s %-8s %8lu %8.1f%% %9.2f%% %9.0f%s\n", ScenarioName[Scenario], PolicyName[Policy],
+                Runs[0].Switches, Runs[0].OnBetter, Runs[0].Deficit, Nanos[Nanos.size() / 2],
+                Thrash ? "  FAIL thrashes more than LEVEL" : "");
+            Failed += Thrash;
+        }
+    }
+
+    return Failed != 0;
+}
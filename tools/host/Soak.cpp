@@ -0,0 +1,488 @@
+/*******************************************************************************
+ Soak - Seeded randomised soak of setup() and loop() against invariants.
+
+    tools/host/build.sh tools/host/Soak.cpp build/Soak
+    build/Soak [-n scenarios] [-t seconds] [-j jobs] [-s first seed] [-x shrinks]
+
+Each seed makes one scenario: both receivers' starting level and noise, the
+buttons held at power up (debug mode, calibration) and let go BOOT_HOLD_MILLIS
+later, the reset cause, and a list of timed events - fades to a new level,
+noise changes, one reading spikes, receivers failing (rail, stuck, floating)
+or recovering, and button presses. The scenario runs for its virtual time in
+its own forked process, up to jobs at once, and after every loop() pass the
+invariants are checked:
+
+  INVARIANT_PERCENT  RSSI1P and RSSI2P are within 0-100.
+  INVARIANT_DWELL    no diversity switch comes within the DiversityIntervalMillis
+                     it was made under of the last one, unless it is the
+                     quarantine dropping the one faulty receiver.
+  INVARIANT_FAULTY   in diversity mode the video is never left on a faulty
+                     receiver when the other is healthy.
+  INVARIANT_HANG     a single pass, calibration included, always returns
+                     within CALIB_TIMEOUT_MILLIS and HANG_MARGIN_MILLIS.
+
+The first failing seeds are shrunk: events are dropped, in halves and then
+one at a time, for as long as the same invariant still fails, and the run is
+cut off just after the failure. What is left is printed as the minimal
+failing trace. The throughput is reported at the end, in scenarios, virtual
+seconds and loop passes per second of wall time. Exits non-zero if any
+scenario fails.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <random>
+#include <chrono>
+#include <map>
+#include "Sketch.cpp"
+
+#define HANG_MARGIN_MILLIS 10000                        /* Allowed past CALIB_TIMEOUT_MILLIS for a single pass. */
+#define BOOT_HOLD_MILLIS 100                            /* Buttons held at power up are let go this long after. */
+#define BUTTON_PIN(b) ((b) == 0 ? MODE_SWITCH : VIDEO_SWITCH)
+
+enum Invariant { INVARIANT_NONE, INVARIANT_PERCENT, INVARIANT_DWELL, INVARIANT_FAULTY, INVARIANT_HANG, INVARIANT_CRASH };
+const char *InvariantName[] = { "none", "percent out of 0-100", "switch inside dwell window", "video left on faulty receiver", "pass never returned", "crashed" };
+
+enum EventType { EVENT_FADE, EVENT_NOISE, EVENT_SPIKE, EVENT_FAULT, EVENT_PRESS };
+const char *EventName[] = { "fade to", "noise", "spike", "fault", "press for ms" };
+
+enum FaultType { FAULT_NONE, FAULT_RAIL, FAULT_STUCK, FAULT_FLOATING };
+
+struct Event
+{
+    unsigned long Millis;
+    byte Type;
+    byte Which;                                         /* Receiver, or button 0 mode / 1 video for EVENT_PRESS. */
+    int Value;
+};
+
+struct Scenario
+{
+    unsigned int Seed;
+    unsigned long Millis;                               /* Virtual run time. */
+    bool BootMode;                                      /* Mode button held at power up, debug mode. */
+    bool BootVideo;                                     /* Video button held at power up, calibration. */
+    byte ResetCause;
+    int Level[2];
+    int Noise[2];
+    std::vector<Event> Events;
+};
+
+struct Result
+{
+    int Failed;                                         /* Invariant. */
+    unsigned long Millis;                               /* When it failed. */
+    unsigned long Passes;
+};
+
+/* Model state, in the forked run. */
+const Scenario *Run1;
+std::mt19937 Random;
+size_t NextEvent;
+double Level[2];
+double Target[2];
+double Noise[2];
+int Fault[2];
+int StuckAt[2];
+double Charge[2];
+int Spike[2];
+unsigned long PressUntil[2];
+unsigned long ModelMillis;
+unsigned long PassStart;
+int ResultPipe;
+
+void Report(int Failed, unsigned long Passes)
+{
+    Result Outcome = { Failed, HostMicros / 1000, Passes };
+
+    write(ResultPipe, &Outcome, sizeof(Outcome));
+    _exit(0);
+}
+
+/* Moves the model on to the current millisecond, and watches for a pass that never ends. */
+void Tick(void)
+{
+    unsigned long Now = HostMicros / 1000;
+
+    if(Now == ModelMillis)
+    {
+        return;
+    }
+
+    for(; ModelMillis < Now; ModelMillis++)
+    {
+        for(int Rx = 0; Rx < 2; Rx++)
+        {
+            Level[Rx] += (Target[Rx] - Level[Rx]) * 0.02;
+        }
+    }
+
+    while(NextEvent < Run1->Events.size() && Run1->Events[NextEvent].Millis <= Now)
+    {
+        const Event &Next = Run1->Events[NextEvent++];
+
+        switch(Next.Type)
+        {
+            case EVENT_FADE:  Target[Next.Which] = Next.Value; break;
+            case EVENT_NOISE: Noise[Next.Which] = Next.Value; break;
+            case EVENT_SPIKE: Spike[Next.Which] = Next.Value; break;
+            case EVENT_FAULT: Fault[Next.Which] = Next.Value; StuckAt[Next.Which] = -1; Charge[Next.Which] = Level[Next.Which]; break;
+            case EVENT_PRESS: PressUntil[Next.Which] = Next.Millis + Next.Value; break;
+        }
+    }
+
+    for(int Button = 0; Button < 2; Button++)
+    {
+        HostPin[BUTTON_PIN(Button)] = (Now < PressUntil[Button]) ? LOW : HIGH;
+    }
+
+    if(Now - PassStart > CALIB_TIMEOUT_MILLIS + HANG_MARGIN_MILLIS)
+    {
+        Report(INVARIANT_HANG, 0);
+    }
+}
+
+int ReceiverADC(int Rx)
+{
+    int Value;
+
+    switch(Fault[Rx])
+    {
+        case FAULT_RAIL:
+            return 5 + (Random() % 10);
+
+        case FAULT_STUCK:
+            if(StuckAt[Rx] < 0)
+            {
+                StuckAt[Rx] = (int)Level[Rx];
+            }
+
+            return StuckAt[Rx];
+
+        case FAULT_FLOATING:
+            Charge[Rx] += 0.4 * (HostLastConversion - Charge[Rx]);
+            return (int)(Charge[Rx] + 150 * sin(2 * M_PI * 50 * HostMicros / 1e6));
+    }
+
+    Value = (int)(Level[Rx] + std::normal_distribution<double>(0, Noise[Rx])(Random)) + Spike[Rx];
+    Spike[Rx] = 0;
+    return constrain(Value, 0, 1023);
+}
+
+int SoakADC(int Channel)
+{
+    return (Channel < 2) ? ReceiverADC(Channel) : HostADCValue[Channel];
+}
+
+/* In the forked process: a fresh sketch, run to the end or the first broken invariant. */
+void Run(const Scenario &Test)
+{
+    Run1 = &Test;
+    Random.seed(Test.Seed);
+
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        Level[Rx] = Target[Rx] = Test.Level[Rx];
+        Noise[Rx] = Test.Noise[Rx];
+    }
+
+    HostADC = SoakADC;
+    HostTick = Tick;
+    HostPin[MODE_SWITCH] = Test.BootMode ? LOW : HIGH;
+    HostPin[VIDEO_SWITCH] = Test.BootVideo ? LOW : HIGH;
+    PressUntil[0] = Test.BootMode ? BOOT_HOLD_MILLIS : 0;
+    PressUntil[1] = Test.BootVideo ? BOOT_HOLD_MILLIS : 0;
+    MCUSR = Test.ResetCause;
+    PassStart = 0;
+    setup();
+
+    unsigned long Passes = 0;
+    unsigned long LastSwitch = 0;                       /* Start of the pass that made the last diversity switch. */
+    int Selected = RxControlPinState;
+    int Mode = ModeSwitchCounter;
+
+    while(HostMicros / 1000 < Test.Millis)
+    {
+        PassStart = HostMicros / 1000;
+        loop();
+        Passes++;
+
+        unsigned long Now = HostMicros / 1000;
+        bool Quarantine = (HealthFault[0] != HEALTH_OK) != (HealthFault[1] != HEALTH_OK);
+
+        if(RSSI1P < 0 || RSSI1P > 100 || RSSI2P < 0 || RSSI2P > 100)
+        {
+            Report(INVARIANT_PERCENT, Passes);
+        }
+
+        /* Both switches were decided somewhere inside their passes, so the
+           time between them is at most Now less the start of the last one's.
+           DiversityIntervalMillis is left as this pass's decision used it. */
+        if(RxControlPinState != Selected && ModeSwitchCounter == 3 && Mode == 3)
+        {
+            if(Quarantine == false && (Now - LastSwitch) <= DiversityIntervalMillis)
+            {
+                Report(INVARIANT_DWELL, Passes);
+            }
+
+            LastSwitch = PassStart;
+        }
+
+        if(ModeSwitchCounter == 3 && Quarantine == true
+            && HealthFault[(RxControlPinState == HIGH) ? 1 : 0] != HEALTH_OK)
+        {
+            Report(INVARIANT_FAULTY, Passes);
+        }
+
+        Selected = RxControlPinState;
+        Mode = ModeSwitchCounter;
+        HostSerialOut.clear();
+    }
+
+    Report(INVARIANT_NONE, Passes);
+}
+
+Scenario Generate(unsigned int Seed, unsigned long Millis)
+{
+    std::mt19937 Dice(Seed);
+    std::uniform_real_distribution<double> Uniform(0, 1);
+    Scenario Test;
+
+    Test.Seed = Seed;
+    Test.Millis = Millis;
+    Test.BootMode = Uniform(Dice) < 0.5;
+    Test.BootVideo = Uniform(Dice) < 0.25;
+    Test.ResetCause = (Uniform(Dice) < 0.25) ? _BV(BORF) : _BV(PORF);
+
+    for(int Rx = 0; Rx < 2; Rx++)
+    {
+        Test.Level[Rx] = 400 + (int)(Uniform(Dice) * 600);
+        Test.Noise[Rx] = (int)(Uniform(Dice) * 8);
+    }
+
+    if(Test.BootVideo == true)                          /* Someone to press mode for each calibration stage, or not. */
+    {
+        for(unsigned long At = 1000; At < 25000; At += 1000 + (Dice() % 8000))
+        {
+            Test.Events.push_back(Event { At, EVENT_PRESS, 0, 50 + (int)(Dice() % 400) });
+        }
+    }
+
+    for(unsigned long At = 0; At < Millis; At++)
+    {
+        for(int Rx = 0; Rx < 2; Rx++)
+        {
+            double Roll = Uniform(Dice);
+
+            if(Roll < 0.002)
+            {
+                Test.Events.push_back(Event { At, EVENT_FADE, (byte)Rx, 300 + (int)(Uniform(Dice) * 723) });
+            }
+
+            else if(Roll < 0.0021)
+            {
+                Test.Events.push_back(Event { At, EVENT_NOISE, (byte)Rx, (int)(Uniform(Dice) * 15) });
+            }
+
+            else if(Roll < 0.0022)
+            {
+                Test.Events.push_back(Event { At, EVENT_SPIKE, (byte)Rx, (int)(400 * (Uniform(Dice) - 0.5)) });
+            }
+
+            else if(Roll < 0.00222)
+            {
+                Test.Events.push_back(Event { At, EVENT_FAULT, (byte)Rx, (int)(Dice() % 4) });
+            }
+
+            else
+            {
+                /* Do Nothing */
+            }
+        }
+
+        double Roll = Uniform(Dice);
+
+        if(Roll < 0.0003)
+        {
+            Test.Events.push_back(Event { At, EVENT_PRESS, (byte)(Roll < 0.0002 ? 0 : 1), 50 + (int)(Dice() % 400) });
+        }
+    }
+
+    return Test;
+}
+
+/* Starts Test in a child process, whose Result comes back through the returned pipe. */
+pid_t Start(const Scenario &Test, int &Pipe)
+{
+    int Ends[2];
+
+    fflush(stdout);
+    pipe(Ends);
+    pid_t Child = fork();
+
+    if(Child == 0)
+    {
+        close(Ends[0]);
+        ResultPipe = Ends[1];
+        Run(Test);
+    }
+
+    close(Ends[1]);
+    Pipe = Ends[0];
+    return Child;
+}
+
+Result Finish(pid_t Child, int Pipe)
+{
+    Result Outcome = { INVARIANT_CRASH, 0, 0 };
+    int Status;
+
+    read(Pipe, &Outcome, sizeof(Outcome));
+    close(Pipe);
+    waitpid(Child, &Status, 0);
+    return Outcome;
+}
+
+Result RunOne(const Scenario &Test)
+{
+    int Pipe;
+    pid_t Child = Start(Test, Pipe);
+
+    return Finish(Child, Pipe);
+}
+
+/* Drops what the failure doesn't need, keeping the same invariant failing. */
+Scenario Shrink(Scenario Test, Result &Failure)
+{
+    Test.Millis = Failure.Millis + 1000;
+
+    for(size_t Chunk = Test.Events.size() / 2; Chunk > 0; Chunk /= 2)
+    {
+        for(size_t From = 0; From < Test.Events.size(); )
+        {
+            Scenario Smaller = Test;
+            size_t To = (From + Chunk < Smaller.Events.size()) ? From + Chunk : Smaller.Events.size();
+
+            Smaller.Events.erase(Smaller.Events.begin() + From, Smaller.Events.begin() + To);
+            Result Outcome = RunOne(Smaller);
+
+            if(Outcome.Failed == Failure.Failed)
+            {
+                Test = Smaller;
+                Test.Millis = Outcome.Millis + 1000;
+                Failure = Outcome;
+            }
+
+            else
+            {
+                From += Chunk;
+            }
+        }
+    }
+
+    while(Test.Events.empty() == false && Test.Events.back().Millis > Test.Millis)
+    {
+        Test.Events.pop_back();
+    }
+
+    return Test;
+}
+
+void PrintTrace(const Scenario &Test, const Result &Failure)
+{
+    printf("seed %u: %s at %lu ms, minimal trace of %zu events:\n", Test.Seed, InvariantName[Failure.Failed],
+        Failure.Millis, Test.Events.size());
+    printf("  boot: mode button %s, video button %s, reset cause 0x%02X\n", Test.BootMode ? "held" : "up",
+        Test.BootVideo ? "held" : "up", Test.ResetCause);
+    printf("  start: RX1 %d noise %d, RX2 %d noise %d\n", Test.Level[0], Test.Noise[0], Test.Level[1], Test.Noise[1]);
+
+    for(size_t Index = 0; Index < Test.Events.size(); Index++)
+    {
+        const Event &Next = Test.Events[Index];
+
+        printf("  %8lu ms  %s%d %s %d\n", Next.Millis, Next.Type == EVENT_PRESS ? "button " : "RX",
+            Next.Type == EVENT_PRESS ? Next.Which : Next.Which + 1, EventName[Next.Type], Next.Value);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long Count = 1000;
+    unsigned long Seconds = 60;
+    unsigned long Jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int FirstSeed = 1;
+    unsigned long Shrinks = 3;
+    int Option;
+
+    while((Option = getopt(argc, argv, "n:t:j:s:x:")) != -1)
+    {
+        switch(Option)
+        {
+            case 'n': Count = strtoul(optarg, 0, 0); break;
+            case 't': Seconds = strtoul(optarg, 0, 0); break;
+            case 'j': Jobs = strtoul(optarg, 0, 0); break;
+            case 's': FirstSeed = strtoul(optarg, 0, 0); break;
+            case 'x': Shrinks = strtoul(optarg, 0, 0); break;
+
+            default:
+                fprintf(stderr, "usage: %s [-n scenarios] [-t seconds] [-j jobs] [-s first seed] [-x shrinks]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    std::map<pid_t, std::pair<unsigned int, int> > Running;     /* Child to seed and result pipe. */
+    std::vector<std::pair<unsigned int, Result> > Failures;
+    unsigned long Started = 0;
+    unsigned long long Passes = 0;
+    auto Begin = std::chrono::steady_clock::now();
+
+    while(Started < Count || Running.empty() == false)
+    {
+        while(Started < Count && Running.size() < Jobs)
+        {
+            int Pipe;
+            unsigned int Seed = FirstSeed + Started++;
+            pid_t Child = Start(Generate(Seed, Seconds * 1000), Pipe);
+
+            Running[Child] = std::make_pair(Seed, Pipe);
+        }
+
+        int Status;
+        pid_t Child = wait(&Status);
+        Result Outcome = { INVARIANT_CRASH, 0, 0 };
+
+        read(Running[Child].second, &Outcome, sizeof(Outcome));
+        close(Running[Child].second);
+        Passes += Outcome.Passes;
+
+        if(Outcome.Failed != INVARIANT_NONE)
+        {
+            Failures.push_back(std::make_pair(Running[Child].first, Outcome));
+        }
+
+        Running.erase(Child);
+    }
+
+    double Wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+
+    for(size_t Failure = 0; Failure < Failures.size(); Failure++)
+    {
+        if(Failure < Shrinks)
+        {
+            Result Outcome = Failures[Failure].second;
+            Scenario Minimal = Shrink(Generate(Failures[Failure].first, Seconds * 1000), Outcome);
+
+            PrintTrace(Minimal, Outcome);
+        }
+
+        else
+        {
+            printf("seed %u: %s at %lu ms\n", Failures[Failure].first, InvariantName[Failures[Failure].second.Failed],
+                Failures[Failure].second.Millis);
+        }
+    }
+
+    printf("%lu scenarios of %lu s, %zu failed, %lu jobs, %.1f s: %.1f scenarios/s, %.0f virtual s/s, %.0f passes/s\n",
+        Count, Seconds, Failures.size(), Jobs, Wall, Count / Wall, Count * Seconds / Wall, Passes / Wall);
+    return Failures.empty() == false;
+}
@@ -0,0 +1,194 @@
+/*******************************************************************************
+ TrackerSim - Antenna tracker convergence and slew limit in closed loop.
+
+    tools/host/build.sh tools/host/TrackerSim.cpp build/TrackerSim -DTRACKER_ENABLED=true && build/TrackerSim
+
+The servo pulse the sketch sends on OC1B moves a model servo at 60 degrees
+per 0.1s (1000us of pulse is 180 degrees). The patch receiver sees the target
+through a beam pattern 8dB up on boresight and 12dB down 60 degrees off it,
+the omni sees a flat 2dB, and both see the link fade together. RSSI is
+FADE_STEPS_PER_DB ADC steps per dB.
+
+Each scenario checks the aim settles within AIM_TOLERANCE of the target by
+SETTLE_SECONDS and stays there, a moving target may be trailed by a further
+LAG_SECONDS of its movement. It also checks the servo pulse never moves more in
+any SLEW_WINDOW_MILLIS than TRACKER_SLEW per TRACKER_INTERVAL_MILLIS allows,
+stalls of the loop included. Exits non-zero if any scenario fails.
+*******************************************************************************/
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <deque>
+#include "Sketch.cpp"
+
+#define RUN_SECONDS 30
+#define SETTLE_SECONDS 15                               /* After the start, or after a jump of the target. */
+#define AIM_TOLERANCE 15                                /* Microseconds of servo pulse, ~3 degrees. */
+#define LAG_SECONDS 1.5                                 /* Time a moving target may be trailed by, on top of AIM_TOLERANCE. */
+#define PASS_MICROS 200                                 /* Loop time spent away from the ADC, added to every pass. */
+#define FADE_STEPS_PER_DB 8
+#define SERVO_MICROS_PER_MILLI 3.33                     /* 60 degrees per 0.1s. */
+#define SLEW_WINDOW_MILLIS 100                          /* Servo pulse movement is checked over every window this long. */
+#define SLEW_LIMIT (TRACKER_SLEW * ((SLEW_WINDOW_MILLIS / TRACKER_INTERVAL_MILLIS) + 1))
+
+struct Scenario
+{
+    const char *Name;
+    double Target;                                      /* Servo pulse pointing the patch at the target, microseconds. */
+    double Rate;                                        /* Target movement, microseconds per second. */
+    double FadeDb;                                      /* Fading of the whole link, dB either way at 0.7Hz. */
+    double JumpAt;                                      /* Seconds, 0 for none. */
+    double Jump;
+    double StallAt;                                     /* Seconds, the loop stops for StallMillis, 0 for none. */
+    unsigned long StallMillis;
+    bool Debug;                                         /* Serial debug text running. */
+};
+
+const Scenario *Test;
+double Servo;
+double Target;
+
+double Pattern(double Offset)
+{
+    double Gain = 8 - (12 * (Offset / 333.0) * (Offset / 333.0));
+
+    return (Gain < -12) ? -12 : Gain;
+}
+
+int TrackerADC(int Channel)
+{
+    double Seconds = HostMicros / 1e6;
+    double Link = Test->FadeDb * sin(2 * M_PI * 0.7 * Seconds);
+    double Db;
+
+    if(Channel == (TRACKER_PATCH_RX == 0 ? 0 : 1))
+    {
+        Db = Pattern(Servo - Target) + Link;
+    }
+
+    else if(Channel < 2)
+    {
+        Db = 2 + Link;
+    }
+
+    else
+    {
+        return HostADCValue[Channel];
+    }
+
+    return constrain(744 + (int)(FADE_STEPS_PER_DB * Db) + (rand() % 5) - 2, 0, 1023);
+}
+
+int Run(void)
+{
+    HostADC = TrackerADC;
+    HostPin[MODE_SWITCH] = Test->Debug ? LOW : HIGH;
+    HostPin[VIDEO_SWITCH] = HIGH;
+    MCUSR = _BV(BORF);                                  /* Skip the boot show. */
+    setup();
+    HostPin[MODE_SWITCH] = HIGH;
+    ModeSwitchCounter = 3;
+    Servo = TRACKER_SERVO_CENTRE;
+
+    unsigned long Previous = HostMicros;
+    double Settled = -1;
+    double WorstError = 0;
+    int WorstSlew = 0;
+    int Command = OCR1B / 2;
+    std::deque<std::pair<unsigned long, int> > Moves;  /* Time and size of each servo pulse change in the window. */
+    int Moved = 0;
+    bool Stalled = false;
+    double Tolerance = AIM_TOLERANCE + (LAG_SECONDS * fabs(Test->Rate));
+
+    while(HostMicros < RUN_SECONDS * 1000000UL)
+    {
+        double Seconds = HostMicros / 1e6;
+        double Millis = (HostMicros - Previous) / 1000.0;
+        double Wanted = OCR1B / 2.0;
+        double Step = SERVO_MICROS_PER_MILLI * Millis;
+
+        Previous = HostMicros;
+        Servo += (Wanted > Servo) ? fmin(Step, Wanted - Servo) : -fmin(Step, Servo - Wanted);
+        Target = Test->Target + (Test->Rate * Seconds) + ((Test->JumpAt > 0 && Seconds >= Test->JumpAt) ? Test->Jump : 0);
+
+        if(Test->StallAt > 0 && Stalled == false && Seconds >= Test->StallAt)
+        {
+            HostMicros += Test->StallMillis * 1000;     /* As calibration holds the loop. */
+            Stalled = true;
+        }
+
+        loop();
+        HostMicros += PASS_MICROS;
+
+        if(OCR1B / 2 != Command)
+        {
+            Moves.push_back(std::make_pair(HostMicros / 1000, abs(OCR1B / 2 - Command)));
+            Moved += abs(OCR1B / 2 - Command);
+            Command = OCR1B / 2;
+
+            while(Moves.front().first + SLEW_WINDOW_MILLIS <= HostMicros / 1000)
+            {
+                Moved -= Moves.front().second;
+                Moves.pop_front();
+            }
+
+            WorstSlew = (Moved > WorstSlew) ? Moved : WorstSlew;
+        }
+
+        double Error = fabs(TrackerAim - Target);
+        double Since = Seconds - ((Test->JumpAt > 0 && Seconds >= Test->JumpAt) ? Test->JumpAt : 0);
+
+        if(Error > Tolerance || TrackerScanning == true)
+        {
+            Settled = Since;
+        }
+
+        if(Since > SETTLE_SECONDS)
+        {
+            WorstError = fmax(WorstError, Error);
+        }
+    }
+
+    bool Pass = Settled < SETTLE_SECONDS && WorstError <= Tolerance && WorstSlew <= SLEW_LIMIT;
+
+    printf("%-28s %s  settled %5.2f s  worst error %5.1f us  worst %3d us in %d ms (limit %d)\n", Test->Name,
+        Pass ? "PASS" : "FAIL", Settled, WorstError, WorstSlew, SLEW_WINDOW_MILLIS, SLEW_LIMIT);
+    fflush(stdout);
+    return Pass ? 0 : 1;
+}
+
+int main(void)
+{
+    Scenario Tests[] =
+    {
+        { "30 deg off",                1500 + 167, 0,  0 },
+        { "60 deg off",                1500 - 333, 0,  0 },
+        { "jump 100 deg at 10 s",      1300,       0,  0, 10, 550 },
+        { "60 deg off, 3dB fade",      1500 - 333, 0,  3 },
+        { "moving 4 deg/s",            1200,       22, 0 },
+        { "2 s stall at 1 s",          1500 - 333, 0,  0, 0, 0, 1, 2000 },
+        { "debug text",                1500 - 333, 0,  0, 0, 0, 0, 0, true },
+    };
+
+    int Failed = 0;
+    int Count = sizeof(Tests) / sizeof(Tests[0]);
+
+    for(int Index = 0; Index < Count; Index++)
+    {
+        fflush(stdout);
+
+        if(fork() == 0)
+        {
+            srand(1 + Index);
+            Test = &Tests[Index];
+            _exit(Run());
+        }
+
+        int Status;
+        wait(&Status);
+        Failed += (WIFEXITED(Status) == 0 || WEXITSTATUS(Status) != 0);
+    }
+
+    printf("%d of %d scenarios failed\n", Failed, Count);
+    return Failed > 0;
+}
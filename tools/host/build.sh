@@ -0,0 +1,28 @@
+#!/bin/sh
+# build.sh driver.cpp output [compiler flags]
+#
+# Builds a host test driver around Div4RX5808-PRO.c. The sketch gets function
+# prototypes the way the Arduino IDE adds them and is written to Sketch.cpp
+# next to the output, for the driver to #include "Sketch.cpp" and reach all of
+# the sketch's globals.
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 driver.cpp output [compiler flags]" >&2
+    exit 2
+fi
+
+Host=$(cd "$(dirname "$0")" && pwd)
+Sketch="$Host/../../Div4RX5808-PRO.c"
+Driver=$1
+Output=$2
+shift 2
+Build=$(dirname "$Output")
+mkdir -p "$Build"
+
+tr -d '\r' < "$Sketch" > "$Build/Sketch.c"
+grep -E '^(void|int|unsigned int|unsigned long|long|boolean|byte|float)[ ]+[A-Za-z_0-9]+[ ]*\(.*\)[ ]*$' "$Build/Sketch.c" | sed 's/$/;/' > "$Build/Prototypes.h"
+awk '/^void setup\(\)/ && !Done { print "#include \"Prototypes.h\""; Done = 1 } { print }' "$Build/Sketch.c" > "$Build/Sketch.cpp"
+
+${CXX:-g++} -std=gnu++11 -O2 -Wall -Wextra -Wno-missing-field-initializers -I"$Host" -I"$Build" -include Arduino.h "$@" -o "$Output" "$Driver" "$Host/ArduinoStub.cpp"
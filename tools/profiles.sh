@@ -0,0 +1,48 @@
+#!/bin/sh
+# profiles.sh [build directory]
+#
+# Builds Div4RX5808-PRO in each BUILD_PROFILE and reports, per profile, flash
+# and RAM from avr-size.
+#
+# Needs arduino-cli with the arduino:avr core installed, and avr-size on the
+# PATH (it comes with the core). FQBN picks the board, the old bootloader Nano
+# by default. Loop times per profile have to be read off a board, with
+# PROFILE_BENCH's loop timing. The host build's LoopTime counts only virtual
+# time, so it can't tell the profiles' CPU time apart.
+
+set -e
+
+Tools=$(cd "$(dirname "$0")" && pwd)
+Build=${1:-build/profiles}
+FQBN=${FQBN:-arduino:avr:nano:cpu=atmega328old}
+Profiles="PROFILE_RACE PROFILE_STANDARD PROFILE_BENCH"
+
+mkdir -p "$Build"
+
+echo "Flash and RAM (avr-size, ATmega328: 30720 bytes flash, 2048 bytes RAM)"
+
+if command -v arduino-cli > /dev/null 2>&1; then
+    for Profile in $Profiles; do
+        Sketch="$Build/$Profile/Div4RX5808-PRO"
+        mkdir -p "$Sketch"
+        cp "$Tools/../Div4RX5808-PRO.c" "$Sketch/Div4RX5808-PRO.ino"
+        arduino-cli compile --fqbn "$FQBN" --build-property "compiler.cpp.extra_flags=-DBUILD_PROFILE=$Profile" \
+            --output-dir "$Build/$Profile/out" "$Sketch" > "$Build/$Profile/compile.log"
+        Elf=$(ls "$Build/$Profile/out"/*.elf)
+
+        if command -v avr-size > /dev/null 2>&1; then
+            printf "%-18s " "$Profile"
+            avr-size -A "$Elf" | awk '
+                $1 == ".text" || $1 == ".data" { Flash += $2 }
+                $1 == ".data" || $1 == ".bss" || $1 == ".noinit" { RAM += $2 }
+                END { printf "flash %6d  RAM %5d  (stack and heap %d)\n", Flash, RAM, 2048 - RAM }'
+        else
+            printf "%-18s " "$Profile"
+            grep -E "^(Sketch uses|Global variables)" "$Build/$Profile/compile.log" | tr '\n' ' '
+            echo
+        fi
+    done
+else
+    echo "  arduino-cli not found, skipped"
+    exit 1
+fi
@@ -0,0 +1,230 @@
+/*******************************************************************************
+ DecisionLatency - Split the latency of each diversity switch in decision dumps.
+
+    DecisionLatency [-v] capture ...
+
+Finds every "D4RD" dump in the captures (see DIVERSITY DECISION TRACE FORMAT
+in Div4RX5808-PRO.c), checks its checksum and, for each SWITCH record, walks
+back through the records before it:
+
+  dwell       the HOLD_DWELL records straight before the switch,
+  hysteresis  the HOLD_HYSTERESIS records before those,
+  filter      from the raw RSSI of the other receiver crossing above the
+              selected one, to the start of the hysteresis.
+
+Prints each switch, then the mean and longest of each part over all dumps.
+With -v every record is printed as well. Capture the serial port as it is,
+text and all, after sending 'q' to stop the debug text and 'd' to dump.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#define DECISION_HEADER_BYTES 8
+#define DECISION_RECORD_BYTES 12
+#define DECISION_HOLD_HYSTERESIS 1
+#define DECISION_HOLD_DWELL 2
+#define DECISION_SWITCH 3
+
+const char *RuleName[] = { "BETTER", "HYST", "DWELL", "SWITCH", "QUAR", "FROZEN" };
+
+struct Record
+{
+    uint64_t Millis;                                    /* Unwrapped from the 16 bit figure. */
+    unsigned int Percent[2];
+    unsigned int Raw[2];
+    unsigned int Elapsed;
+    unsigned int Interval;
+    unsigned int Hysteresis;
+    unsigned int Rule;
+    unsigned int Policy;
+    unsigned int Selected;                              /* 0 = RX1, 1 = RX2, after the evaluation. */
+};
+
+struct Part
+{
+    uint64_t Total;
+    uint64_t Longest;
+
+    void Add(uint64_t Millis)
+    {
+        Total += Millis;
+        Longest = (Millis > Longest) ? Millis : Longest;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    bool Verbose = false;
+    int Argument = 1;
+
+    if(argc > 1 && strcmp(argv[1], "-v") == 0)
+    {
+        Verbose = true;
+        Argument = 2;
+    }
+
+    if(Argument >= argc)
+    {
+        fprintf(stderr, "usage: %s [-v] capture ...\n", argv[0]);
+        return 2;
+    }
+
+    Part Filter = { 0, 0 }, Hysteresis = { 0, 0 }, Dwell = { 0, 0 }, Latency = { 0, 0 };
+    unsigned long Switches = 0;
+    unsigned long Dumps = 0;
+    unsigned long Bad = 0;
+
+    for(; Argument < argc; Argument++)
+    {
+        FILE *File = fopen(argv[Argument], "rb");
+
+        if(File == 0)
+        {
+            perror(argv[Argument]);
+            return 1;
+        }
+
+        std::vector<uint8_t> Data;
+        uint8_t Buffer[65536];
+        size_t Got;
+
+        while((Got = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+        {
+            Data.insert(Data.end(), Buffer, Buffer + Got);
+        }
+
+        fclose(File);
+
+        for(size_t At = 0; At + DECISION_HEADER_BYTES < Data.size(); At++)
+        {
+            if(memcmp(&Data[At], "D4RD", 4) != 0 || Data[At + 5] != DECISION_RECORD_BYTES)
+            {
+                continue;
+            }
+
+            size_t Count = Data[At + 6];
+            size_t Length = DECISION_HEADER_BYTES + (Count * DECISION_RECORD_BYTES);
+            uint8_t Checksum = 0;
+
+            if(At + Length >= Data.size())
+            {
+                Bad++;
+                continue;
+            }
+
+            for(size_t Byte = 0; Byte < Length; Byte++)
+            {
+                Checksum += Data[At + Byte];
+            }
+
+            if(Checksum != Data[At + Length])
+            {
+                Bad++;
+                continue;
+            }
+
+            std::vector<Record> Records(Count);
+            uint64_t Wrap = 0;
+
+            for(size_t Index = 0; Index < Count; Index++)
+            {
+                const uint8_t *Bytes = &Data[At + DECISION_HEADER_BYTES + (Index * DECISION_RECORD_BYTES)];
+                Record &Next = Records[Index];
+                uint64_t Millis = Bytes[0] | (Bytes[1] << 8);
+
+                if(Index > 0 && Millis + Wrap < Records[Index - 1].Millis)
+                {
+                    Wrap += 65536;
+                }
+
+                Next.Millis = Millis + Wrap;
+                Next.Percent[0] = Bytes[2];
+                Next.Percent[1] = Bytes[3];
+                Next.Raw[0] = Bytes[4];
+                Next.Raw[1] = Bytes[5];
+                Next.Elapsed = Bytes[6] | (Bytes[7] << 8);
+                Next.Interval = Bytes[8] | (Bytes[9] << 8);
+                Next.Hysteresis = Bytes[10];
+                Next.Rule = Bytes[11] & 0x0F;
+                Next.Policy = (Bytes[11] >> 4) & 0x07;
+                Next.Selected = Bytes[11] >> 7;
+            }
+
+            Dumps++;
+            printf("%s: dump at byte %zu, version %u, %zu records%s\n", argv[Argument], At, Data[At + 4], Count,
+                Data[At + 7] ? ", held by a slow switch" : "");
+
+            for(size_t Index = 0; Index < Count; Index++)
+            {
+                const Record &Next = Records[Index];
+
+                if(Verbose == true)
+                {
+                    printf("  %8llu ms  %% %3u/%3u  raw %3u/%3u  since switch %5u  interval %4u  hyst %2u  policy %u  %-6s RX%u\n",
+                        (unsigned long long)Next.Millis, Next.Percent[0], Next.Percent[1], Next.Raw[0], Next.Raw[1],
+                        Next.Elapsed, Next.Interval, Next.Hysteresis, Next.Policy,
+                        Next.Rule < 6 ? RuleName[Next.Rule] : "?", Next.Selected + 1);
+                }
+
+                if(Next.Rule != DECISION_SWITCH)
+                {
+                    continue;
+                }
+
+                unsigned int Before = 1 - Next.Selected;    /* Receiver selected before the switch. */
+                size_t Walk = Index;
+                uint64_t DwellStart = Next.Millis;
+                uint64_t HysteresisStart;
+                uint64_t Cross;
+
+                while(Walk > 0 && Records[Walk - 1].Rule == DECISION_HOLD_DWELL)
+                {
+                    DwellStart = Records[--Walk].Millis;
+                }
+
+                HysteresisStart = DwellStart;
+
+                while(Walk > 0 && Records[Walk - 1].Rule == DECISION_HOLD_HYSTERESIS)
+                {
+                    HysteresisStart = Records[--Walk].Millis;
+                }
+
+                Cross = HysteresisStart;
+
+                while(Walk > 0 && Records[Walk - 1].Raw[1 - Before] > Records[Walk - 1].Raw[Before])
+                {
+                    Cross = Records[--Walk].Millis;
+                }
+
+                printf("  switch to RX%u at %llu ms: %llu ms = filter %llu + hysteresis %llu + dwell %llu%s\n",
+                    Next.Selected + 1, (unsigned long long)Next.Millis, (unsigned long long)(Next.Millis - Cross),
+                    (unsigned long long)(HysteresisStart - Cross), (unsigned long long)(DwellStart - HysteresisStart),
+                    (unsigned long long)(Next.Millis - DwellStart), Walk == 0 ? " (run-up not all in the dump)" : "");
+
+                Filter.Add(HysteresisStart - Cross);
+                Hysteresis.Add(DwellStart - HysteresisStart);
+                Dwell.Add(Next.Millis - DwellStart);
+                Latency.Add(Next.Millis - Cross);
+                Switches++;
+            }
+
+            At += Length;
+        }
+    }
+
+    printf("%lu dumps, %lu bad, %lu switches\n", Dumps, Bad, Switches);
+
+    if(Switches > 0)
+    {
+        printf("  mean / longest ms: total %.1f / %llu  filter %.1f / %llu  hysteresis %.1f / %llu  dwell %.1f / %llu\n",
+            (double)Latency.Total / Switches, (unsigned long long)Latency.Longest,
+            (double)Filter.Total / Switches, (unsigned long long)Filter.Longest,
+            (double)Hysteresis.Total / Switches, (unsigned long long)Hysteresis.Longest,
+            (double)Dwell.Total / Switches, (unsigned long long)Dwell.Longest);
+    }
+
+    return 0;
+}
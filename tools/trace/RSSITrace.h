@@ -0,0 +1,629 @@
+/*******************************************************************************
+ RSSITrace.h - Read Div4RX5808-PRO binary RSSI traces. (see RSSI TRACE FORMAT)
+
+Header only, POSIX. A trace is memory mapped and never copied: blocks are
+checked and indexed once, then decoded straight out of the mapping. The index
+is kept next to the trace as <trace>.idx so a large corpus is only scanned the
+first time it is opened.
+
+A serial capture usually has debug text before the "D4RT" header and may have
+more text, or damaged blocks, between blocks. Anything that doesn't pass the
+block checksum is skipped.
+
+    RSSITrace Trace;
+
+    if(Trace.Open("flight.d4rt") == true)
+    {
+        RSSITraceCursor Cursor(Trace);
+        RSSITraceSample Sample;
+
+        while(Cursor.Next(Sample) == true)
+        {
+            ... Sample.RSSI1, Sample.RSSI2, Sample.RX2Selected, Sample.Index
+        }
+    }
+
+For bulk work RSSITrace::DecodeBlock() decodes a block at a time.
+*******************************************************************************/
+
+#ifndef RSSI_TRACE_H
+#define RSSI_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Format, as Div4RX5808-PRO.c. */
+#define RSSI_TRACE_VERSION 1
+#define RSSI_TRACE_HEADER_BYTES 18
+#define RSSI_TRACE_BLOCK_HEADER_BYTES 8
+#define RSSI_TRACE_BLOCK_SAMPLES 28
+#define RSSI_TRACE_SYNC 0xA5
+
+/* Index file. */
+#define RSSI_TRACE_INDEX_VERSION 1
+#define RSSI_TRACE_INDEX_HEADER_BYTES 32
+#define RSSI_TRACE_INDEX_ENTRY_BYTES 16
+
+
+struct RSSITraceHeader
+{
+    unsigned int Version;
+    unsigned int IntervalMillis;        /* Time between samples. */
+    unsigned int RSSI1Min;              /* Calibration, ADC steps. */
+    unsigned int RSSI1Max;
+    unsigned int RSSI2Min;
+    unsigned int RSSI2Max;
+    unsigned int ARefMillivolts;        /* ADC reference. */
+};
+
+struct RSSITraceBlock
+{
+    uint64_t Offset;                    /* Of the sync byte in the file. */
+    uint64_t FirstSample;               /* Index of the first sample, counting samples actually present. */
+    uint16_t Sequence;                  /* As sent, a gap means blocks were lost. */
+    uint8_t Samples;
+};
+
+struct RSSITraceSample
+{
+    uint64_t Index;                     /* Sample number in the trace. */
+    uint16_t RSSI1;                     /* ADC steps. */
+    uint16_t RSSI2;
+    bool RX2Selected;                   /* Sent at the first sample of each block, held for the rest. (see RSSI TRACE FORMAT) */
+};
+
+
+class RSSITrace
+{
+public:
+
+    RSSITrace() : Data(0), Size(0), HeaderOffset(0), SampleCount(0), LostBlocks(0) { memset(&Header, 0, sizeof(Header)); }
+    ~RSSITrace() { Close(); }
+
+    /* Map and index a trace. Uses, or writes, <Path>.idx unless UseIndexFile is false. */
+    bool Open(const std::string &Path, bool UseIndexFile = true)
+    {
+        Close();
+        int File = open(Path.c_str(), O_RDONLY);
+        struct stat Info;
+
+        if(File < 0 || fstat(File, &Info) != 0 || Info.st_size == 0)
+        {
+            Error = "can't open " + Path;
+            if(File >= 0) close(File);
+            return false;
+        }
+
+        Size = Info.st_size;
+        void *Map = mmap(0, Size, PROT_READ, MAP_SHARED, File, 0);
+        close(File);
+
+        if(Map == MAP_FAILED)
+        {
+            Error = "can't map " + Path;
+            Size = 0;
+            return false;
+        }
+
+        Data = (const uint8_t *)Map;
+        madvise(Map, Size, MADV_SEQUENTIAL);
+
+        if(FindHeader() == false)
+        {
+            Error = "no D4RT header in " + Path;
+            Close();
+            return false;
+        }
+
+        IndexPath = Path + ".idx";
+
+        if(UseIndexFile == false || LoadIndex(Info) == false)
+        {
+            Scan();
+
+            if(UseIndexFile == true)
+            {
+                SaveIndex(Info);
+            }
+        }
+
+        return true;
+    }
+
+    void Close()
+    {
+        if(Data != 0)
+        {
+            munmap((void *)Data, Size);
+        }
+
+        Data = 0;
+        Size = 0;
+        Blocks.clear();
+        SampleCount = 0;
+        LostBlocks = 0;
+    }
+
+    const RSSITraceHeader &Info() const { return Header; }
+    const std::vector<RSSITraceBlock> &Index() const { return Blocks; }
+    uint64_t Samples() const { return SampleCount; }
+    uint64_t Lost() const { return LostBlocks; }
+    uint64_t Bytes() const { return Size; }
+    const std::string &LastError() const { return Error; }
+
+    /* Block holding sample Index, for seeking. Returns Blocks.size() past the end. */
+    size_t FindBlock(uint64_t Index) const
+    {
+        size_t Low = 0;
+        size_t High = Blocks.size();
+
+        while(Low < High)
+        {
+            size_t Middle = (Low + High) / 2;
+
+            if(Blocks[Middle].FirstSample + Blocks[Middle].Samples <= Index)
+            {
+                Low = Middle + 1;
+            }
+
+            else
+            {
+                High = Middle;
+            }
+        }
+
+        return Low;
+    }
+
+    /* Block holding the sample taken Millis after the start, ignoring lost blocks. */
+    size_t FindTime(uint64_t Millis) const
+    {
+        return FindBlock(Header.IntervalMillis > 0 ? Millis / Header.IntervalMillis : 0);
+    }
+
+    /* Pointer to a block in the mapping. */
+    const uint8_t *BlockData(size_t Block) const { return Data + Blocks[Block].Offset; }
+
+    /* Decode a whole block into RSSI1[] and RSSI2[], RSSI_TRACE_BLOCK_SAMPLES long. Returns the samples. Quickest way through a corpus. */
+    unsigned int DecodeBlock(size_t Block, uint16_t *RSSI1, uint16_t *RSSI2, bool &RX2Selected) const
+    {
+        const uint8_t *Bytes = BlockData(Block);
+        const int8_t *Delta = (const int8_t *)(Bytes + RSSI_TRACE_BLOCK_HEADER_BYTES);
+        unsigned int Samples = Bytes[1];
+        uint16_t Value1 = (Bytes[4] | (Bytes[5] << 8)) & 0x3FF;
+        uint16_t Value2 = (Bytes[6] | (Bytes[7] << 8)) & 0x3FF;
+
+        RX2Selected = (Bytes[5] & 0x80) != 0;
+        RSSI1[0] = Value1;
+        RSSI2[0] = Value2;
+
+        for(unsigned int Sample = 1; Sample < Samples; Sample++)
+        {
+            Value1 += Delta[0];
+            Value2 += Delta[1];
+            RSSI1[Sample] = Value1;
+            RSSI2[Sample] = Value2;
+            Delta += 2;
+        }
+
+        return Samples;
+    }
+
+private:
+
+    const uint8_t *Data;
+    uint64_t Size;
+    uint64_t HeaderOffset;
+    uint64_t SampleCount;
+    uint64_t LostBlocks;
+    RSSITraceHeader Header;
+    std::vector<RSSITraceBlock> Blocks;
+    std::string IndexPath;
+    std::string Error;
+
+    static unsigned int Word(const uint8_t *Bytes) { return Bytes[0] | (Bytes[1] << 8); }
+
+    bool FindHeader()
+    {
+        for(uint64_t Offset = 0; Offset + RSSI_TRACE_HEADER_BYTES <= Size; Offset++)
+        {
+            const uint8_t *Bytes = Data + Offset;
+
+            if(Bytes[0] == 'D' && Bytes[1] == '4' && Bytes[2] == 'R' && Bytes[3] == 'T' && Bytes[5] >= RSSI_TRACE_HEADER_BYTES)
+            {
+                HeaderOffset = Offset;
+                Header.Version = Bytes[4];
+                Header.IntervalMillis = Word(Bytes + 6);
+                Header.RSSI1Min = Word(Bytes + 8);
+                Header.RSSI1Max = Word(Bytes + 10);
+                Header.RSSI2Min = Word(Bytes + 12);
+                Header.RSSI2Max = Word(Bytes + 14);
+                Header.ARefMillivolts = Word(Bytes + 16);
+                HeaderOffset += Bytes[5];
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /* Length of a valid block at Offset, or 0. */
+    size_t CheckBlock(uint64_t Offset) const
+    {
+        const uint8_t *Bytes = Data + Offset;
+
+        if(Offset + 2 > Size || Bytes[0] != RSSI_TRACE_SYNC || Bytes[1] == 0 || Bytes[1] > RSSI_TRACE_BLOCK_SAMPLES)
+        {
+            return 0;
+        }
+
+        size_t Length = RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Bytes[1] - 1));
+
+        if(Offset + Length + 1 > Size)
+        {
+            return 0;
+        }
+
+        uint8_t Checksum = 0;
+
+        for(size_t Byte = 0; Byte < Length; Byte++)
+        {
+            Checksum += Bytes[Byte];
+        }
+
+        return (Checksum == Bytes[Length]) ? Length + 1 : 0;
+    }
+
+    void Scan()
+    {
+        uint64_t Offset = HeaderOffset;
+        int Expected = -1;
+
+        Blocks.clear();
+        SampleCount = 0;
+        LostBlocks = 0;
+
+        while(Offset < Size)
+        {
+            size_t Length = CheckBlock(Offset);
+
+            if(Length == 0)
+            {
+                Offset++;       /* Text or damage, look for the next sync. */
+                continue;
+            }
+
+            RSSITraceBlock Block;
+            Block.Offset = Offset;
+            Block.FirstSample = SampleCount;
+            Block.Sequence = Word(Data + Offset + 2);
+            Block.Samples = Data[Offset + 1];
+
+            if(Expected >= 0 && Block.Sequence != Expected)
+            {
+                LostBlocks += (uint16_t)(Block.Sequence - Expected);
+            }
+
+            Expected = (uint16_t)(Block.Sequence + 1);
+            Blocks.push_back(Block);
+            SampleCount += Block.Samples;
+            Offset += Length;
+        }
+    }
+
+    /*
+    Index file, little endian:
+      0   4   "D4RI"
+      4   4   RSSI_TRACE_INDEX_VERSION
+      8   8   Trace size, bytes
+      16  8   Trace modification time, seconds
+      24  4   Blocks
+      28  4   Lost blocks
+      32  16n Offset (8), first sample (6), sequence (2), samples in the block (1), unused (-)
+    Each entry's block must lie inside the trace, its sample count is read from
+    the block itself. Otherwise entries are taken as written.
+    */
+
+    bool LoadIndex(const struct stat &Info)
+    {
+        FILE *File = fopen(IndexPath.c_str(), "rb");
+        uint8_t Head[RSSI_TRACE_INDEX_HEADER_BYTES];
+
+        if(File == 0)
+        {
+            return false;
+        }
+
+        bool Valid = fread(Head, 1, sizeof(Head), File) == sizeof(Head)
+            && memcmp(Head, "D4RI", 4) == 0
+            && Get(Head + 4, 4) == RSSI_TRACE_INDEX_VERSION
+            && Get(Head + 8, 8) == (uint64_t)Info.st_size
+            && Get(Head + 16, 8) == (uint64_t)Info.st_mtime;
+
+        if(Valid == true)
+        {
+            uint64_t Count = Get(Head + 24, 4);
+            std::vector<uint8_t> Entries(Count * RSSI_TRACE_INDEX_ENTRY_BYTES);
+
+            Valid = fread(Entries.data(), 1, Entries.size(), File) == Entries.size();
+            Blocks.resize(Valid == true ? Count : 0);
+            SampleCount = 0;
+
+            for(uint64_t Entry = 0; Valid == true && Entry < Count; Entry++)
+            {
+                const uint8_t *Bytes = Entries.data() + (Entry * RSSI_TRACE_INDEX_ENTRY_BYTES);
+                Blocks[Entry].Offset = Get(Bytes, 8);
+                Blocks[Entry].FirstSample = Get(Bytes + 8, 6);
+                Blocks[Entry].Sequence = Get(Bytes + 14, 2);
+                Valid = Blocks[Entry].Offset < Size - 1;     /* Offset + 1 < Size, without wrapping. */
+
+                if(Valid == true)
+                {
+                    Blocks[Entry].Samples = Data[Blocks[Entry].Offset + 1];
+                    Valid = Blocks[Entry].Samples > 0 && Blocks[Entry].Samples <= RSSI_TRACE_BLOCK_SAMPLES
+                        && Blocks[Entry].Offset + RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Blocks[Entry].Samples - 1)) < Size;
+                    SampleCount = Blocks[Entry].FirstSample + Blocks[Entry].Samples;
+                }
+            }
+
+            LostBlocks = Get(Head + 28, 4);
+        }
+
+        fclose(File);
+        return Valid;
+    }
+
+    void SaveIndex(const struct stat &Info) const
+    {
+        FILE *File = fopen(IndexPath.c_str(), "wb");
+        uint8_t Head[RSSI_TRACE_INDEX_HEADER_BYTES];
+        uint8_t Entry[RSSI_TRACE_INDEX_ENTRY_BYTES];
+
+        if(File == 0)
+        {
+            return;     /* Read only corpus, scan again next time. */
+        }
+
+        memcpy(Head, "D4RI", 4);
+        Put(Head + 4, 4, RSSI_TRACE_INDEX_VERSION);
+        Put(Head + 8, 8, Info.st_size);
+        Put(Head + 16, 8, Info.st_mtime);
+        Put(Head + 24, 4, Blocks.size());
+        Put(Head + 28, 4, LostBlocks);
+        fwrite(Head, 1, sizeof(Head), File);
+
+        for(size_t Block = 0; Block < Blocks.size(); Block++)
+        {
+            memset(Entry, 0, sizeof(Entry));
+            Put(Entry, 8, Blocks[Block].Offset);
+            Put(Entry + 8, 6, Blocks[Block].FirstSample);
+            Put(Entry + 14, 2, Blocks[Block].Sequence);
+            fwrite(Entry, 1, sizeof(Entry), File);
+        }
+
+        fclose(File);
+    }
+
+    static uint64_t Get(const uint8_t *Bytes, int Count)
+    {
+        uint64_t Value = 0;
+
+        for(int Byte = Count - 1; Byte >= 0; Byte--)
+        {
+            Value = (Value << 8) | Bytes[Byte];
+        }
+
+        return Value;
+    }
+
+    static void Put(uint8_t *Bytes, int Count, uint64_t Value)
+    {
+        for(int Byte = 0; Byte < Count; Byte++)
+        {
+            Bytes[Byte] = Value >> (8 * Byte);
+        }
+    }
+};
+
+
+/*******************************************************************************
+ RSSITraceCursor - Walk the samples of a trace in order, from any sample.
+*******************************************************************************/
+
+class RSSITraceCursor
+{
+public:
+
+    RSSITraceCursor(const RSSITrace &Trace, uint64_t From = 0) : Trace(Trace) { Seek(From); }
+
+    void Seek(uint64_t Index)
+    {
+        Block = Trace.FindBlock(Index);
+        Position = 0;
+        Skip = 0;
+
+        if(Block < Trace.Index().size())
+        {
+            Skip = Index - Trace.Index()[Block].FirstSample;
+        }
+    }
+
+    bool Next(RSSITraceSample &Sample)
+    {
+        while(Skip > 0 && Step(Sample) == true)
+        {
+            Skip--;
+        }
+
+        return Step(Sample);
+    }
+
+private:
+
+    const RSSITrace &Trace;
+    size_t Block;
+    unsigned int Position;
+    uint64_t Skip;
+    const uint8_t *Bytes;
+    uint16_t RSSI1;
+    uint16_t RSSI2;
+    bool RX2Selected;
+
+    bool Step(RSSITraceSample &Sample)
+    {
+        if(Block >= Trace.Index().size())
+        {
+            return false;
+        }
+
+        if(Position == 0)
+        {
+            Bytes = Trace.BlockData(Block);
+            RSSI1 = (Bytes[4] | (Bytes[5] << 8)) & 0x3FF;
+            RSSI2 = (Bytes[6] | (Bytes[7] << 8)) & 0x3FF;
+            RX2Selected = (Bytes[5] & 0x80) != 0;
+        }
+
+        else
+        {
+            const uint8_t *Delta = Bytes + RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Position - 1));
+            RSSI1 += (int8_t)Delta[0];
+            RSSI2 += (int8_t)Delta[1];
+        }
+
+        Sample.Index = Trace.Index()[Block].FirstSample + Position;
+        Sample.RSSI1 = RSSI1;
+        Sample.RSSI2 = RSSI2;
+        Sample.RX2Selected = RX2Selected;
+
+        if(++Position >= Trace.Index()[Block].Samples)
+        {
+            Block++;
+            Position = 0;
+        }
+
+        return true;
+    }
+};
+
+/*******************************************************************************
+ RSSITraceWriter - Write a trace the way the firmware does. (see TraceSample)
+*******************************************************************************/
+
+class RSSITraceWriter
+{
+public:
+
+    RSSITraceWriter() : File(0), Sequence(0), Count(0), Previous1(0), Previous2(0) {}
+    ~RSSITraceWriter() { Close(); }
+
+    bool Open(const std::string &Path, const RSSITraceHeader &Info)
+    {
+        uint8_t Head[RSSI_TRACE_HEADER_BYTES] = { 'D', '4', 'R', 'T', RSSI_TRACE_VERSION, RSSI_TRACE_HEADER_BYTES };
+        unsigned int Fields[6] = { Info.IntervalMillis, Info.RSSI1Min, Info.RSSI1Max, Info.RSSI2Min, Info.RSSI2Max, Info.ARefMillivolts };
+
+        File = fopen(Path.c_str(), "wb");
+
+        if(File == 0)
+        {
+            return false;
+        }
+
+        for(int Field = 0; Field < 6; Field++)
+        {
+            Head[6 + (2 * Field)] = Fields[Field] & 0xFF;
+            Head[7 + (2 * Field)] = Fields[Field] >> 8;
+        }
+
+        fwrite(Head, 1, sizeof(Head), File);
+        return true;
+    }
+
+    void Add(unsigned int RSSI1, unsigned int RSSI2, bool RX2Selected)
+    {
+        int Delta1 = (int)RSSI1 - Previous1;
+        int Delta2 = (int)RSSI2 - Previous2;
+
+        if(Count > 0 && (Delta1 > 127 || Delta1 < -128 || Delta2 > 127 || Delta2 < -128))
+        {
+            Flush();
+        }
+
+        if(Count == 0)
+        {
+            unsigned int First1 = RSSI1 | (RX2Selected == true ? 0x8000 : 0);
+            Block[0] = RSSI_TRACE_SYNC;
+            Block[2] = Sequence & 0xFF;
+            Block[3] = Sequence >> 8;
+            Block[4] = First1 & 0xFF;
+            Block[5] = First1 >> 8;
+            Block[6] = RSSI2 & 0xFF;
+            Block[7] = RSSI2 >> 8;
+        }
+
+        else
+        {
+            Block[RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Count - 1))] = (uint8_t)Delta1;
+            Block[RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Count - 1)) + 1] = (uint8_t)Delta2;
+        }
+
+        Previous1 = RSSI1;
+        Previous2 = RSSI2;
+
+        if(++Count >= RSSI_TRACE_BLOCK_SAMPLES)
+        {
+            Flush();
+        }
+    }
+
+    void Close()
+    {
+        if(File != 0)
+        {
+            Flush();
+            fclose(File);
+            File = 0;
+        }
+    }
+
+private:
+
+    FILE *File;
+    uint16_t Sequence;
+    unsigned int Count;
+    int Previous1;
+    int Previous2;
+    uint8_t Block[RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (RSSI_TRACE_BLOCK_SAMPLES - 1)) + 1];
+
+    void Flush()
+    {
+        size_t Length = RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * (Count - 1));
+        uint8_t Checksum = 0;
+
+        if(Count == 0)
+        {
+            return;
+        }
+
+        Block[1] = Count;
+
+        for(size_t Byte = 0; Byte < Length; Byte++)
+        {
+            Checksum += Block[Byte];
+        }
+
+        Block[Length] = Checksum;
+        fwrite(Block, 1, Length + 1, File);
+        Sequence++;
+        Count = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,200 @@
+/*******************************************************************************
+ RSSITraceConvert - Turn a serial debug capture into a binary RSSI trace.
+
+    RSSITraceConvert [-i millis] [-c min1,max1,min2,max2] [-r millivolts] capture.txt out.d4rt
+
+Reads the text the firmware prints in serial debug mode and writes one trace
+sample per debug record, ended by the "RX =" field. The raw "RSSI1 =" and
+"RSSI2 =" readings are used when the capture is from a PROFILE_BENCH build,
+the averages otherwise.
+
+The debug text carries no time, so the sample interval is taken from the
+"Loop us" figures of a bench capture or must be given with -i. The calibration
+is taken from the "MIN/MAX" figures of a bench capture, from -c, or left at
+the firmware defaults. Captures with text and binary traces mixed, from using
+'t', can be read as they are by RSSITrace.h.
+*******************************************************************************/
+
+#include "RSSITrace.h"
+#include <stdlib.h>
+
+struct DebugRecord
+{
+    long Raw1, Raw2, Average1, Average2, Min1, Max1, Min2, Max2, RX, LoopMicros;
+};
+
+/* Number after Key in Line, or Missing. Keys are matched whole, "RSSI1 =" is not "RSSI1_AVERAGE =". */
+static long Field(const std::string &Line, const char *Key, long Missing, long *Second = 0)
+{
+    size_t At = Line.find(Key);
+
+    if(At == std::string::npos)
+    {
+        return Missing;
+    }
+
+    const char *Text = Line.c_str() + At + strlen(Key);
+    char *End;
+    long Value = strtol(Text, &End, 10);
+
+    if(End == Text)
+    {
+        return Missing;
+    }
+
+    if(Second != 0 && *End == '/')
+    {
+        *Second = strtol(End + 1, 0, 10);
+    }
+
+    return Value;
+}
+
+int main(int argc, char **argv)
+{
+    RSSITraceHeader Info = { RSSI_TRACE_VERSION, 0, 512, 1023, 512, 1023, 1100 };     /* Firmware defaults. */
+    bool CalibrationGiven = false;
+    int Argument = 1;
+
+    for(; Argument < argc - 2; Argument++)
+    {
+        if(strcmp(argv[Argument], "-i") == 0 && Argument + 1 < argc - 2)
+        {
+            Info.IntervalMillis = atoi(argv[++Argument]);
+        }
+
+        else if(strcmp(argv[Argument], "-c") == 0 && Argument + 1 < argc - 2)
+        {
+            CalibrationGiven = sscanf(argv[++Argument], "%u,%u,%u,%u", &Info.RSSI1Min, &Info.RSSI1Max, &Info.RSSI2Min, &Info.RSSI2Max) == 4;
+        }
+
+        else if(strcmp(argv[Argument], "-r") == 0 && Argument + 1 < argc - 2)
+        {
+            Info.ARefMillivolts = atoi(argv[++Argument]);
+        }
+
+        else
+        {
+            break;
+        }
+    }
+
+    if(Argument != argc - 2)
+    {
+        fprintf(stderr, "usage: %s [-i millis] [-c min1,max1,min2,max2] [-r millivolts] capture.txt out.d4rt\n", argv[0]);
+        return 2;
+    }
+
+    FILE *Input = fopen(argv[argc - 2], "rb");
+
+    if(Input == 0)
+    {
+        fprintf(stderr, "can't open %s\n", argv[argc - 2]);
+        return 1;
+    }
+
+    /* Split into records at each "RX =" field, the debug line ends there. */
+    std::vector<DebugRecord> Records;
+    std::string Record;
+    int Character;
+
+    while((Character = fgetc(Input)) != EOF)
+    {
+        Record += (Character == '\r' || Character == '\n') ? ' ' : (char)Character;
+
+        size_t At = Record.find("  RX =");
+
+        if(At != std::string::npos && (Character == '\r' || Character == '\n'))
+        {
+            DebugRecord Fields;
+            Fields.Min1 = Fields.Max1 = Fields.Min2 = Fields.Max2 = -1;
+            Fields.Raw1 = Field(Record, "  RSSI1 =", -1);
+            Fields.Raw2 = Field(Record, "  RSSI2 =", -1);
+            Fields.Average1 = Field(Record, "  RSSI1_AVERAGE =", -1);
+            Fields.Average2 = Field(Record, "  RSSI2_AVERAGE =", -1);
+            Fields.Min1 = Field(Record, "  RSSI1 MIN/MAX =", -1, &Fields.Max1);
+            Fields.Min2 = Field(Record, "  RSSI2 MIN/MAX =", -1, &Fields.Max2);
+            Fields.RX = Field(Record, "  RX =", -1);
+            Fields.LoopMicros = Field(Record, "  Loop us ", -1);
+
+            if(Fields.Average1 >= 0 && Fields.Average2 >= 0 && Fields.RX >= 0)
+            {
+                Records.push_back(Fields);
+            }
+
+            Record.clear();
+        }
+
+        else if(Record.size() > 4096)
+        {
+            Record.erase(0, Record.size() - 1024);     /* Binary or other junk, keep looking. */
+        }
+    }
+
+    fclose(Input);
+
+    if(Records.empty())
+    {
+        fprintf(stderr, "no debug records in %s\n", argv[argc - 2]);
+        return 1;
+    }
+
+    /* "Loop us" is printed before the next record's RSSI fields, so it belongs to the pass before. */
+    double LoopTotal = 0;
+    long LoopCount = 0;
+
+    for(size_t Index = 0; Index < Records.size(); Index++)
+    {
+        if(Records[Index].LoopMicros > 0)
+        {
+            LoopTotal += Records[Index].LoopMicros;
+            LoopCount++;
+        }
+
+        if(CalibrationGiven == false && Records[Index].Min1 >= 0 && Records[Index].Max2 >= 0)
+        {
+            Info.RSSI1Min = Records[Index].Min1;
+            Info.RSSI1Max = Records[Index].Max1;
+            Info.RSSI2Min = Records[Index].Min2;
+            Info.RSSI2Max = Records[Index].Max2;
+        }
+    }
+
+    if(Info.IntervalMillis == 0 && LoopCount > 0)
+    {
+        Info.IntervalMillis = (unsigned int)(LoopTotal / LoopCount / 1000 + 0.5);
+        Info.IntervalMillis = (Info.IntervalMillis == 0) ? 1 : Info.IntervalMillis;
+    }
+
+    if(Info.IntervalMillis == 0)
+    {
+        fprintf(stderr, "sample interval unknown, not a bench capture, give -i millis\n");
+        return 1;
+    }
+
+    RSSITraceWriter Writer;
+
+    if(Writer.Open(argv[argc - 1], Info) == false)
+    {
+        fprintf(stderr, "can't write %s\n", argv[argc - 1]);
+        return 1;
+    }
+
+    bool Raw = true;
+
+    for(size_t Index = 0; Index < Records.size(); Index++)
+    {
+        Raw = Raw && Records[Index].Raw1 >= 0 && Records[Index].Raw2 >= 0;
+    }
+
+    for(size_t Index = 0; Index < Records.size(); Index++)
+    {
+        const DebugRecord &Fields = Records[Index];
+        Writer.Add(Raw ? Fields.Raw1 : Fields.Average1, Raw ? Fields.Raw2 : Fields.Average2, Fields.RX == 1);
+    }
+
+    Writer.Close();
+    printf("%zu samples, %s readings, %u ms interval, calibration %u/%u %u/%u\n", Records.size(), Raw ? "raw" : "averaged",
+        Info.IntervalMillis, Info.RSSI1Min, Info.RSSI1Max, Info.RSSI2Min, Info.RSSI2Max);
+    return 0;
+}
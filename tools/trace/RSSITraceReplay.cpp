@@ -0,0 +1,105 @@
+/*******************************************************************************
+ RSSITraceReplay - Summarise a trace, or a corpus of traces, and time replay.
+
+    RSSITraceReplay [-s seconds] trace.d4rt ...
+
+Opens each trace through RSSITrace.h, building its .idx on first use, and
+decodes every sample. Prints the header, lost blocks, per receiver minimum /
+mean / maximum and how long the receivers were selected, then the replay rate
+over the whole corpus, in samples and in block bytes decoded. With -s, replay
+starts that far into each trace, found through the index.
+*******************************************************************************/
+
+#include "RSSITrace.h"
+#include <stdlib.h>
+#include <chrono>
+
+int main(int argc, char **argv)
+{
+    uint64_t StartMillis = 0;
+    int Argument = 1;
+
+    if(argc > 2 && strcmp(argv[1], "-s") == 0)
+    {
+        StartMillis = (uint64_t)(atof(argv[2]) * 1000);
+        Argument = 3;
+    }
+
+    if(Argument >= argc)
+    {
+        fprintf(stderr, "usage: %s [-s seconds] trace.d4rt ...\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t TotalBytes = 0;
+    uint64_t TotalSamples = 0;
+    double TotalSeconds = 0;
+
+    for(; Argument < argc; Argument++)
+    {
+        RSSITrace Trace;
+
+        if(Trace.Open(argv[Argument]) == false)
+        {
+            fprintf(stderr, "%s\n", Trace.LastError().c_str());
+            return 1;
+        }
+
+        const RSSITraceHeader &Info = Trace.Info();
+        uint64_t From = Info.IntervalMillis > 0 ? StartMillis / Info.IntervalMillis : 0;
+        uint64_t Sum1 = 0, Sum2 = 0, Count = 0, Selected2 = 0;
+        unsigned int Min1 = 0xFFFF, Min2 = 0xFFFF, Max1 = 0, Max2 = 0;
+        uint16_t RSSI1[RSSI_TRACE_BLOCK_SAMPLES];
+        uint16_t RSSI2[RSSI_TRACE_BLOCK_SAMPLES];
+        bool RX2Selected;
+        size_t First = Trace.FindBlock(From);
+
+        auto Start = std::chrono::steady_clock::now();
+
+        for(size_t Block = First; Block < Trace.Index().size(); Block++)
+        {
+            unsigned int Samples = Trace.DecodeBlock(Block, RSSI1, RSSI2, RX2Selected);
+
+            for(unsigned int Sample = 0; Sample < Samples; Sample++)
+            {
+                Sum1 += RSSI1[Sample];
+                Sum2 += RSSI2[Sample];
+                Min1 = RSSI1[Sample] < Min1 ? RSSI1[Sample] : Min1;
+                Max1 = RSSI1[Sample] > Max1 ? RSSI1[Sample] : Max1;
+                Min2 = RSSI2[Sample] < Min2 ? RSSI2[Sample] : Min2;
+                Max2 = RSSI2[Sample] > Max2 ? RSSI2[Sample] : Max2;
+            }
+
+            Selected2 += RX2Selected == true ? Samples : 0;
+            Count += Samples;
+        }
+
+        TotalSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+        for(size_t Block = First; Block < Trace.Index().size(); Block++)
+        {
+            TotalBytes += RSSI_TRACE_BLOCK_HEADER_BYTES + (2 * Trace.Index()[Block].Samples) - 1;
+        }
+
+        TotalSamples += Count;
+
+        printf("%s: v%u, %u ms, cal %u/%u %u/%u, aref %u mV, %zu blocks, %llu lost, %llu samples (%.1f s)\n",
+            argv[Argument], Info.Version, Info.IntervalMillis, Info.RSSI1Min, Info.RSSI1Max, Info.RSSI2Min, Info.RSSI2Max,
+            Info.ARefMillivolts, Trace.Index().size(), (unsigned long long)Trace.Lost(), (unsigned long long)Trace.Samples(),
+            Trace.Samples() * Info.IntervalMillis / 1000.0);
+
+        if(Count > 0)
+        {
+            printf("  RX1 %u / %.0f / %u  RX2 %u / %.0f / %u  RX2 selected %.1f%%\n", Min1, (double)Sum1 / Count, Max1,
+                Min2, (double)Sum2 / Count, Max2, 100.0 * Selected2 / Count);
+        }
+    }
+
+    if(TotalSeconds > 0)
+    {
+        printf("replayed %llu samples, %.1f MB, at %.0f Msamples/s, %.2f GB/s\n", (unsigned long long)TotalSamples,
+            TotalBytes / 1e6, TotalSamples / TotalSeconds / 1e6, TotalBytes / TotalSeconds / 1e9);
+    }
+
+    return 0;
+}